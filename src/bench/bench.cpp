@@ -0,0 +1,76 @@
+/**
+ * @file bench.cpp
+ * @brief Shared helpers of the sempress-bench executable
+ */
+#include "bench.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <sys/resource.h>
+namespace fs = std::filesystem;
+
+static std::string read_file(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (not in.is_open()) throw std::runtime_error("Error opening " + path);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  return buffer.str();
+}
+
+std::string load_corpus(const std::string &path) {
+  if (not fs::is_directory(path)) return read_file(path);
+
+  std::vector<std::string> files;
+  for (const auto &entry : fs::recursive_directory_iterator(path)) {
+    if (entry.is_regular_file() and entry.path().extension() == ".cpp") {
+      files.push_back(entry.path().string());
+    }
+  }
+  std::sort(files.begin(), files.end());
+
+  std::string corpus;
+  for (const auto &file : files) corpus += read_file(file);
+  return corpus;
+}
+
+void report(const std::string &name, size_t bytes, double seconds) {
+  double mb = bytes / (1024.0 * 1024.0);
+  std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+            << std::setprecision(3) << std::setw(10) << seconds * 1000
+            << " ms" << std::setprecision(1) << std::setw(10)
+            << (seconds > 0 ? mb / seconds : 0) << " MB/s\n";
+}
+
+size_t parse_size(const std::string &text) {
+  size_t used;
+  unsigned long long value = std::stoull(text, &used);
+  std::string suffix = text.substr(used);
+  if (suffix == "K" or suffix == "k") return value << 10;
+  if (suffix == "M" or suffix == "m") return value << 20;
+  if (suffix == "G" or suffix == "g") return value << 30;
+  if (not suffix.empty()) throw std::invalid_argument("invalid size: " + text);
+  return value;
+}
+
+void reset_peak_rss() {
+  // Writing 5 to clear_refs resets VmHWM (Linux 4.0 and later)
+  std::ofstream clear("/proc/self/clear_refs");
+  if (clear.is_open()) clear << "5";
+}
+
+size_t peak_rss_kb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("VmHWM:", 0) == 0) return std::stoul(line.substr(6));
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<size_t>(usage.ru_maxrss);
+}
@@ -0,0 +1,127 @@
+/**
+ * @file bench.hpp
+ * @brief Shared helpers and entry points of the sempress-bench executable
+ */
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Loads a benchmark corpus into memory
+ *
+ * If the path is a directory, every .cpp file found recursively is
+ * concatenated, in path order, so the corpus is reproducible.
+ *
+ * @param path Path to a file or to a directory of .cpp files
+ * @return std::string Content of the corpus
+ * @throws std::runtime_error If the path cannot be read
+ */
+std::string load_corpus(const std::string &path);
+
+/**
+ * @brief Prints one benchmark measurement
+ *
+ * @param name Name of the measured variant
+ * @param bytes Number of input bytes processed per run
+ * @param seconds Best wall time of one run, in seconds
+ */
+void report(const std::string &name, size_t bytes, double seconds);
+
+/**
+ * @brief Parses a size given in bytes or with a K/M/G suffix
+ *
+ * @param text Size, e.g. "4096", "64K", "100M" or "1G"
+ * @return size_t Size in bytes
+ * @throws std::invalid_argument If the text is not a size
+ */
+size_t parse_size(const std::string &text);
+
+/**
+ * @brief Starts a new peak resident set size measurement
+ *
+ * On Linux, resets the peak of the process (VmHWM) to its current
+ * resident size; elsewhere the peak keeps growing from the process start.
+ */
+void reset_peak_rss();
+
+/**
+ * @brief Returns the peak resident set size since reset_peak_rss()
+ *
+ * @return size_t Peak resident size in KiB
+ */
+size_t peak_rss_kb();
+
+/**
+ * @brief Runs a function several times and returns its best wall time
+ *
+ * @param repeat Number of runs
+ * @param fn Function to be measured
+ * @return double Best wall time of one run, in seconds
+ */
+template <typename Fn> double best_time(int repeat, Fn &&fn) {
+  double best = 0;
+  for (int i = 0; i < repeat; i++) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (i == 0 or elapsed.count() < best) best = elapsed.count();
+  }
+  return best;
+}
+
+/**
+ * @brief Compares the legacy token scan against the TokenMatcher trie
+ *
+ * Usage: matcher <table> <corpus> [repeat]
+ *
+ * @return int Exit code
+ */
+int matcher_bench(int argc, char *argv[]);
+
+/**
+ * @brief Compares the legacy per-bit tree walk against the table decoder
+ *
+ * Usage: decoder <table> <corpus> [repeat]
+ *
+ * @return int Exit code
+ */
+int decoder_bench(int argc, char *argv[]);
+
+/**
+ * @brief Compares the legacy shared_ptr tree build against HuffmanTree
+ *
+ * Usage: tree <symbols> [repeat]
+ *
+ * @return int Exit code
+ */
+int tree_bench(int argc, char *argv[]);
+
+/**
+ * @brief Writes a deterministic synthetic C++ corpus
+ *
+ * Usage: corpus <size> <output> [seed]
+ *
+ * @return int Exit code
+ */
+int generate_corpus(int argc, char *argv[]);
+
+/**
+ * @brief Runs the table, tree, compress and decompress stages on corpora
+ * and reports them as JSON
+ *
+ * Usage: suite [--json <file>] [--repeat <n>] [--work <dir>] <corpus>...
+ *
+ * @return int Exit code
+ */
+int suite_bench(int argc, char *argv[]);
+
+/**
+ * @brief Compares single-stream decoding against 4 interleaved streams
+ *
+ * Usage: interleave <frequency_table> <corpus> [repeat]
+ *
+ * @return int Exit code
+ */
+int interleave_bench(int argc, char *argv[]);
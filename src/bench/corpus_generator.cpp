@@ -0,0 +1,278 @@
+/**
+ * @file corpus_generator.cpp
+ * @brief Deterministic generator of synthetic C++ source, used as a
+ * benchmark corpus of any size
+ */
+#include "bench.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/// Bytes of source buffered before each write
+static constexpr size_t WRITE_CHUNK_SIZE = 1 << 20;
+
+static const std::vector<std::string> TYPES = {
+    "int", "long", "double", "bool", "char", "size_t", "uint32_t", "uint64_t",
+    "std::string", "std::vector<int>", "std::vector<std::string>",
+    "std::unordered_map<std::string, int>", "std::shared_ptr<Node>", "auto"};
+
+static const std::vector<std::string> HEADERS = {
+    "<algorithm>", "<cstdint>", "<iostream>", "<map>", "<memory>", "<string>",
+    "<unordered_map>", "<vector>", "\"config.hpp\"", "\"utils.hpp\""};
+
+static const std::vector<std::string> CALLS = {
+    "std::max", "std::min", "std::sort", "std::swap", "std::move", "push_back",
+    "size", "emplace_back", "find", "insert", "compute", "update", "process"};
+
+static const std::vector<std::string> OPERATORS = {
+    " + ", " - ", " * ", " / ", " % ", " << ", " >> ", " & ", " | ", " ^ "};
+
+static const std::vector<std::string> COMPARISONS = {
+    " < ", " <= ", " > ", " >= ", " == ", " != "};
+
+static const std::vector<std::string> SYLLABLES = {
+    "buf", "count", "data", "index", "item", "key", "len", "node", "offset",
+    "pos", "result", "size", "state", "table", "total", "value", "word"};
+
+static const std::vector<std::string> WORDS = {
+    "the", "of", "a", "to", "is", "returns", "value", "each", "if", "not",
+    "node", "table", "size", "first", "last", "when", "input", "output"};
+
+/**
+ * @class SourceGenerator
+ * @brief Writes random but plausible C++ from a fixed seed
+ *
+ * Randomness comes from splitmix64 and plain modulo reductions rather than
+ * the standard distributions, whose results differ between library
+ * implementations, so a seed gives the same bytes on every platform. Each
+ * random draw is a statement of its own, since the operands of + are
+ * evaluated in no fixed order.
+ */
+class SourceGenerator {
+public:
+  /**
+   * @brief Creates a generator; equal seeds give equal sources
+   */
+  explicit SourceGenerator(uint64_t seed) : state(seed) {}
+
+  /**
+   * @brief Appends one translation unit: includes, a class and its methods
+   *
+   * @param out Source being written
+   */
+  void unit(std::string &out) {
+    out += "// " + sentence() + "\n";
+    const size_t includes = 2 + below(5);
+    for (size_t i = 0; i < includes; i++) out += "#include " + pick(HEADERS) + "\n";
+
+    const std::string space = name();
+    const std::string type = type_name();
+    out += "\nnamespace " + space + " {\n\n";
+
+    // Class declaration
+    std::vector<std::string> methods;
+    out += "/**\n * @brief " + sentence() + "\n */\nclass " + type + " {\npublic:\n";
+    const size_t count = 2 + below(4);
+    for (size_t i = 0; i < count; i++) {
+      const std::string result = pick(TYPES);
+      methods.push_back(name());
+      const std::string list = parameters();
+      out += "  " + result + " " + methods.back() + "(" + list + ")" +
+             (below(2) ? " const" : "") + ";\n";
+    }
+    out += "\nprivate:\n";
+    for (size_t i = 0, members = 1 + below(4); i < members; i++) {
+      const std::string member = pick(TYPES);
+      out += "  " + member + " " + name() + "_;\n";
+    }
+    out += "};\n\n";
+
+    // Method definitions
+    for (const std::string &method : methods) {
+      const std::string result = pick(TYPES);
+      out += result + " " + type + "::" + method + "(" + parameters() + ") {\n";
+      block(out, 1, 3 + below(6));
+      out += "  return " + expression(2) + ";\n}\n\n";
+    }
+    out += "}  // namespace " + space + "\n\n";
+  }
+
+private:
+  uint64_t state; ///< splitmix64 state
+
+  /**
+   * @brief Returns the next 64 random bits (splitmix64)
+   */
+  uint64_t next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  /**
+   * @brief Returns a random number below n
+   */
+  size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+
+  /**
+   * @brief Returns a random element of a list
+   */
+  const std::string &pick(const std::vector<std::string> &list) {
+    return list[below(list.size())];
+  }
+
+  /**
+   * @brief Returns a snake_case identifier of one to three syllables
+   */
+  std::string name() {
+    std::string id = pick(SYLLABLES);
+    for (size_t i = 0, extra = below(3); i < extra; i++) id += "_" + pick(SYLLABLES);
+    return id;
+  }
+
+  /**
+   * @brief Returns a CamelCase type name
+   */
+  std::string type_name() {
+    std::string id;
+    for (size_t i = 0, parts = 1 + below(3); i < parts; i++) {
+      std::string part = pick(SYLLABLES);
+      part[0] = static_cast<char>(part[0] - 'a' + 'A');
+      id += part;
+    }
+    return id;
+  }
+
+  /**
+   * @brief Returns a comment sentence
+   */
+  std::string sentence() {
+    std::string text = pick(WORDS);
+    for (size_t i = 0, words = 3 + below(8); i < words; i++) text += " " + pick(WORDS);
+    return text + ".";
+  }
+
+  /**
+   * @brief Returns a parameter list
+   */
+  std::string parameters() {
+    std::string list;
+    for (size_t i = 0, count = below(4); i < count; i++) {
+      if (i > 0) list += ", ";
+      if (below(2)) list += "const ";
+      list += pick(TYPES);
+      list += below(2) ? " &" : " ";
+      list += name();
+    }
+    return list;
+  }
+
+  /**
+   * @brief Returns an expression of bounded depth
+   */
+  std::string expression(unsigned depth) {
+    std::string text;
+    switch (depth == 0 ? below(2) : below(5)) {
+    case 0:
+      return name();
+    case 1:
+      return std::to_string(below(1000));
+    case 2:
+      text = expression(depth - 1);
+      text += pick(OPERATORS);
+      return text + expression(depth - 1);
+    case 3:
+      text = pick(CALLS) + "(";
+      text += expression(depth - 1) + ", ";
+      return text + expression(depth - 1) + ")";
+    default:
+      text = name() + "[";
+      return text + expression(depth - 1) + "]";
+    }
+  }
+
+  /**
+   * @brief Appends statements at an indentation level
+   */
+  void block(std::string &out, unsigned level, size_t statements) {
+    const std::string indent(2 * level, ' ');
+    for (size_t i = 0; i < statements; i++) {
+      switch (level < 4 ? below(7) : below(3)) {
+      case 0:
+      case 1:
+        out += indent + pick(TYPES) + " ";
+        out += name() + " = ";
+        out += expression(2) + ";\n";
+        break;
+      case 2:
+        out += indent + name();
+        out += below(2) ? " += " : " = ";
+        out += expression(2) + ";\n";
+        break;
+      case 3:
+        out += indent + "// " + sentence() + "\n";
+        break;
+      case 4:
+        out += indent + "for (size_t i = 0; i < " + name() + ".size(); ++i) {\n";
+        block(out, level + 1, 1 + below(3));
+        out += indent + "}\n";
+        break;
+      case 5:
+        out += indent + "if (" + expression(1);
+        out += pick(COMPARISONS);
+        out += expression(1) + ") {\n";
+        block(out, level + 1, 1 + below(3));
+        if (below(3) == 0) {
+          out += indent + "} else {\n";
+          block(out, level + 1, 1 + below(2));
+        }
+        out += indent + "}\n";
+        break;
+      default:
+        out += indent + "while (" + name();
+        out += pick(COMPARISONS);
+        out += expression(1) + ") {\n";
+        block(out, level + 1, 1 + below(3));
+        out += indent + "}\n";
+        break;
+      }
+    }
+  }
+};
+
+int generate_corpus(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: corpus <size> <output> [seed]\n";
+    return 1;
+  }
+  const size_t size = parse_size(argv[1]);
+  const std::string output = argv[2];
+  const uint64_t seed = argc > 3 ? std::stoull(argv[3]) : 1;
+
+  std::ofstream out(output, std::ios::binary);
+  if (not out.is_open()) throw std::runtime_error("Error opening " + output);
+
+  // Whole units are generated and the last one is cut at the requested size
+  SourceGenerator generator(seed);
+  std::string chunk;
+  size_t written = 0;
+  while (written < size) {
+    generator.unit(chunk);
+    if (chunk.size() >= WRITE_CHUNK_SIZE or written + chunk.size() >= size) {
+      const size_t take = std::min(chunk.size(), size - written);
+      out.write(chunk.data(), static_cast<std::streamsize>(take));
+      written += take;
+      chunk.clear();
+    }
+  }
+  if (not out.flush()) throw std::runtime_error("Error writing " + output);
+
+  std::cout << "Wrote " << written << " bytes of synthetic C++ (seed " << seed << ") to "
+            << output << "\n";
+  return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file decoder_bench.cpp
+ * @brief Benchmark of decompression: legacy per-bit tree walk versus the
+ * HuffmanDecoder lookup tables
+ */
+#include "bench.hpp"
+#include "../sempress/bit_reader.hpp"
+#include "../sempress/bit_writer.hpp"
+#include "../sempress/huffman_decoder.hpp"
+#include "../sempress/huffman_tree.hpp"
+#include "../sempress/token_matcher.hpp"
+#include <bitset>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Encodes the corpus in memory the way the compressor does
+ *
+ * @return std::vector<unsigned char> Compressed stream, EOF included
+ */
+static std::vector<unsigned char> encode(const std::string &content,
+                                         const HuffmanTree &tree) {
+  const auto &symbols = tree.getSymbols();
+  TokenMatcher matcher(symbols);
+  BitWriter writer;
+
+  auto writeCode = [&](const std::string &code) {
+    for (char bit : code) writer.write(bit == '1', 1);
+  };
+
+  size_t pos = 0;
+  while (pos < content.length()) {
+    int symbol;
+    size_t length = matcher.longestMatch(content.data() + pos, content.length() - pos, symbol);
+    if (length > 0) {
+      const HuffmanCode &code = tree.getCodes()[symbol];
+      if (code.isPacked()) writer.write(code.bits, code.length);
+      else writeCode(tree.getCodeString(symbol));
+      pos += length;
+    } else {
+      pos++;
+    }
+  }
+  writeCode(tree.getCodeString(tree.getEofSymbol()));
+  writer.alignToByte();
+  return writer.buffer();
+}
+
+/**
+ * @brief Decodes the stream the way the decompressor used to
+ *
+ * Every byte is expanded to eight '0'/'1' characters and the tree is
+ * walked one bit at a time.
+ */
+static std::string legacy_decode(const std::vector<unsigned char> &compressed,
+                                 const HuffmanTree &tree) {
+  std::string binary_string;
+  for (unsigned char byte : compressed) {
+    binary_string += std::bitset<8>(byte).to_string();
+  }
+
+  std::string decoded;
+  const auto &nodes = tree.getNodes();
+  int32_t current = tree.getRoot();
+  for (char bit : binary_string) {
+    current = bit == '0' ? nodes[current].left : nodes[current].right;
+    if (nodes[current].isLeaf()) {
+      if (nodes[current].symbol == tree.getEofSymbol()) break;
+      decoded += tree.getSymbols()[nodes[current].symbol];
+      current = tree.getRoot();
+    }
+  }
+  return decoded;
+}
+
+/**
+ * @brief Decodes the stream with the lookup tables
+ */
+static std::string table_decode(const std::vector<unsigned char> &compressed,
+                                const HuffmanDecoder &decoder) {
+  std::string decoded(compressed.size() * 2 + 4096, '\0');
+  size_t size = 0;
+  HuffmanDecoder::Stop stop = HuffmanDecoder::MORE;
+  BitReader reader(compressed.data(), compressed.size());
+  while (stop == HuffmanDecoder::MORE) {
+    size += decoder.decodeInto(reader, &decoded[size], decoded.size() - size, stop);
+    if (stop == HuffmanDecoder::MORE) decoded.resize(decoded.size() * 2);
+  }
+  decoded.resize(size);
+  return decoded;
+}
+
+int decoder_bench(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: decoder <frequency_table> <corpus> [repeat]\n";
+    return 1;
+  }
+  int repeat = argc > 3 ? std::stoi(argv[3]) : 3;
+
+  HuffmanTree tree(argv[1]);
+  std::string content = load_corpus(argv[2]);
+  std::vector<unsigned char> compressed = encode(content, tree);
+
+  HuffmanDecoder *decoder = nullptr;
+  double build = best_time(repeat, [&] {
+    delete decoder;
+    decoder = new HuffmanDecoder(tree);
+  });
+
+  std::string legacy, table;
+  double legacySeconds = best_time(repeat, [&] { legacy = legacy_decode(compressed, tree); });
+  double tableSeconds = best_time(repeat, [&] { table = table_decode(compressed, *decoder); });
+  delete decoder;
+
+  std::cout << "corpus: " << content.length() << " bytes, compressed to "
+            << compressed.size() << " bytes, tables built in "
+            << build * 1000 << " ms\n";
+  report("per-bit tree walk", legacy.length(), legacySeconds);
+  report("table decoder", table.length(), tableSeconds);
+  std::cout << "speedup: " << legacySeconds / tableSeconds << "x\n";
+
+  if (legacy != table) {
+    std::cerr << "Decoded outputs differ!\n";
+    return 1;
+  }
+  return 0;
+}
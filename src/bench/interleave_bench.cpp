@@ -0,0 +1,129 @@
+/**
+ * @file interleave_bench.cpp
+ * @brief Benchmark of decompression: single bit stream versus 4 interleaved
+ * streams, with the same HuffmanTree and HuffmanDecoder
+ */
+#include "bench.hpp"
+#include "../sempress/bit_reader.hpp"
+#include "../sempress/bit_writer.hpp"
+#include "../sempress/huffman_decoder.hpp"
+#include "../sempress/huffman_tree.hpp"
+#include "../sempress/token_matcher.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// Block size used by the compressor with -j
+static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+/// One block encoded both ways
+struct EncodedBlock {
+  size_t rawSize = 0;                                         ///< Decoded size
+  uint64_t count = 0;                                         ///< Number of tokens
+  std::vector<unsigned char> single;                          ///< Single stream, EOF included
+  std::vector<unsigned char> streams[HuffmanDecoder::INTERLEAVE]; ///< Interleaved streams
+};
+
+/**
+ * @brief Encodes the corpus in blocks, as a single stream and interleaved
+ */
+static std::vector<EncodedBlock> encode(const std::string &content,
+                                        const HuffmanTree &tree) {
+  TokenMatcher matcher(tree.getSymbols());
+  std::vector<EncodedBlock> blocks;
+
+  auto put = [&](BitWriter &writer, int symbol) {
+    const HuffmanCode &code = tree.getCodes()[symbol];
+    if (code.isPacked()) {
+      writer.write(code.bits, code.length);
+    } else {
+      for (char bit : tree.getCodeString(symbol)) writer.write(bit == '1', 1);
+    }
+  };
+
+  for (size_t start = 0; start < content.length(); start += BLOCK_SIZE) {
+    const size_t size = std::min(BLOCK_SIZE, content.length() - start);
+    const char *data = content.data() + start;
+    BitWriter single, streams[HuffmanDecoder::INTERLEAVE];
+    EncodedBlock block;
+
+    size_t pos = 0;
+    while (pos < size) {
+      int symbol;
+      size_t length = matcher.longestMatch(data + pos, size - pos, symbol);
+      if (length > 0) {
+        put(single, symbol);
+        put(streams[block.count++ % HuffmanDecoder::INTERLEAVE], symbol);
+        block.rawSize += length;
+        pos += length;
+      } else {
+        pos++;
+      }
+    }
+    put(single, tree.getEofSymbol());
+
+    single.alignToByte();
+    block.single = single.buffer();
+    for (unsigned i = 0; i < HuffmanDecoder::INTERLEAVE; i++) {
+      streams[i].alignToByte();
+      block.streams[i] = streams[i].buffer();
+    }
+    blocks.push_back(std::move(block));
+  }
+  return blocks;
+}
+
+int interleave_bench(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: interleave <frequency_table> <corpus> [repeat]\n";
+    return 1;
+  }
+  int repeat = argc > 3 ? std::stoi(argv[3]) : 3;
+
+  HuffmanTree tree(argv[1]);
+  HuffmanDecoder decoder(tree);
+  std::string content = load_corpus(argv[2]);
+  std::vector<EncodedBlock> blocks = encode(content, tree);
+
+  size_t rawSize = 0;
+  for (const EncodedBlock &block : blocks) rawSize += block.rawSize;
+  std::string single(rawSize + decoder.getSlack(), '\0');
+  std::string interleaved(rawSize + decoder.getSlack(), '\0');
+
+  double singleSeconds = best_time(repeat, [&] {
+    size_t size = 0;
+    for (const EncodedBlock &block : blocks) {
+      BitReader reader(block.single.data(), block.single.size());
+      HuffmanDecoder::Stop stop;
+      size += decoder.decodeInto(reader, &single[size], block.rawSize + decoder.getSlack(), stop);
+    }
+    single.resize(size);
+  });
+
+  double interleavedSeconds = best_time(repeat, [&] {
+    size_t size = 0;
+    for (const EncodedBlock &block : blocks) {
+      BitReader readers[HuffmanDecoder::INTERLEAVE] = {
+          {block.streams[0].data(), block.streams[0].size()},
+          {block.streams[1].data(), block.streams[1].size()},
+          {block.streams[2].data(), block.streams[2].size()},
+          {block.streams[3].data(), block.streams[3].size()}};
+      uint64_t count = block.count;
+      size += decoder.decodeInterleaved(readers, count, &interleaved[size],
+                                        block.rawSize + decoder.getSlack());
+    }
+    interleaved.resize(size);
+  });
+
+  std::cout << "corpus: " << content.length() << " bytes in " << blocks.size()
+            << " blocks of " << BLOCK_SIZE << " bytes\n";
+  report("single stream", rawSize, singleSeconds);
+  report("4 interleaved streams", rawSize, interleavedSeconds);
+  std::cout << "speedup: " << singleSeconds / interleavedSeconds << "x\n";
+
+  if (single != interleaved or single.length() != rawSize) {
+    std::cerr << "Decoded outputs differ!\n";
+    return 1;
+  }
+  return 0;
+}
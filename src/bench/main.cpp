@@ -0,0 +1,40 @@
+/**
+ * @file main.cpp
+ * @brief Entry point of the sempress-bench executable
+ */
+#include "bench.hpp"
+#include <iostream>
+#include <string>
+
+void usage(char *argv[]) {
+  std::cerr << "Usage:\n"
+            << "  " << argv[0] << " matcher <frequency_table> <corpus> [repeat]\n"
+            << "  " << argv[0] << " decoder <frequency_table> <corpus> [repeat]\n"
+            << "  " << argv[0] << " interleave <frequency_table> <corpus> [repeat]\n"
+            << "  " << argv[0] << " tree <symbols> [repeat]\n"
+            << "  " << argv[0] << " corpus <size> <output> [seed]\n"
+            << "  " << argv[0] << " suite [--json <file>] [--repeat <n>] [--work <dir>] [--inputs <dir>] <corpus>...\n"
+            << "  <corpus>: a file, or a directory whose .cpp files are concatenated (suite: files only)\n"
+            << "  <size>: bytes, or with a K/M/G suffix\n";
+  std::exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) usage(argv);
+
+  std::string name = argv[1];
+  try {
+    if (name == "matcher") return matcher_bench(argc - 1, argv + 1);
+    if (name == "decoder") return decoder_bench(argc - 1, argv + 1);
+    if (name == "interleave") return interleave_bench(argc - 1, argv + 1);
+    if (name == "tree") return tree_bench(argc - 1, argv + 1);
+    if (name == "corpus") return generate_corpus(argc - 1, argv + 1);
+    if (name == "suite") return suite_bench(argc - 1, argv + 1);
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+
+  usage(argv);
+  return 1;
+}
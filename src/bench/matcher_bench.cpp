@@ -0,0 +1,102 @@
+/**
+ * @file matcher_bench.cpp
+ * @brief Benchmark of the compressor tokenization: legacy length-sorted
+ * scan versus the TokenMatcher trie
+ */
+#include "bench.hpp"
+#include "../sempress/huffman_tree.hpp"
+#include "../sempress/token_matcher.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Tokenizes the corpus the way the compressor used to
+ *
+ * Every position walks the length-sorted token list and compares a
+ * substring copy against each candidate.
+ *
+ * @return std::vector<int> Ids of the matched symbols
+ */
+static std::vector<int> legacy_scan(const std::string &content,
+                                    const std::vector<std::string> &symbols) {
+  std::vector<int> order(symbols.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<int>(i);
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return symbols[a].length() > symbols[b].length();
+  });
+
+  std::vector<int> out;
+  size_t pos = 0;
+  while (pos < content.length()) {
+    int matched = TokenMatcher::NO_MATCH;
+    for (int id : order) {
+      if (content.substr(pos, symbols[id].length()) == symbols[id]) {
+        matched = id;
+        break;
+      }
+    }
+    if (matched != TokenMatcher::NO_MATCH) {
+      out.push_back(matched);
+      pos += symbols[matched].length();
+    } else {
+      pos++;
+    }
+  }
+  return out;
+}
+
+/**
+ * @brief Tokenizes the corpus with the precompiled trie
+ *
+ * @return std::vector<int> Ids of the matched symbols
+ */
+static std::vector<int> trie_scan(const std::string &content,
+                                  const TokenMatcher &matcher) {
+  std::vector<int> out;
+  const char *data = content.data();
+  size_t pos = 0;
+  while (pos < content.length()) {
+    int symbol;
+    size_t length = matcher.longestMatch(data + pos, content.length() - pos, symbol);
+    if (length > 0) {
+      out.push_back(symbol);
+      pos += length;
+    } else {
+      pos++;
+    }
+  }
+  return out;
+}
+
+int matcher_bench(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: matcher <frequency_table> <corpus> [repeat]\n";
+    return 1;
+  }
+  int repeat = argc > 3 ? std::stoi(argv[3]) : 3;
+
+  HuffmanTree tree(argv[1]);
+  const std::vector<std::string> &symbols = tree.getSymbols();
+  std::string content = load_corpus(argv[2]);
+
+  TokenMatcher matcher;
+  double build = best_time(repeat, [&] { matcher = TokenMatcher(symbols); });
+
+  std::vector<int> legacy, trie;
+  double legacySeconds = best_time(repeat, [&] { legacy = legacy_scan(content, symbols); });
+  double trieSeconds = best_time(repeat, [&] { trie = trie_scan(content, matcher); });
+
+  std::cout << "corpus: " << content.length() << " bytes, " << symbols.size()
+            << " symbols, trie built in " << build * 1000 << " ms\n";
+  report("legacy scan", content.length(), legacySeconds);
+  report("trie matcher", content.length(), trieSeconds);
+  std::cout << "speedup: " << legacySeconds / trieSeconds << "x\n";
+
+  if (legacy != trie) {
+    std::cerr << "Token streams differ!\n";
+    return 1;
+  }
+  return 0;
+}
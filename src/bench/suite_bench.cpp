@@ -0,0 +1,225 @@
+/**
+ * @file suite_bench.cpp
+ * @brief End-to-end benchmark of the frequency table, HuffmanTree,
+ * Compressor and Decompressor stages, reported as JSON
+ */
+#include "bench.hpp"
+#include "../sempress/compressor.hpp"
+#include "../sempress/decompressor.hpp"
+#include "../sempress/huffman_tree.hpp"
+#include "../table/frequency-table.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+namespace fs = std::filesystem;
+
+/// Size of the pieces in which the round trip is compared
+static constexpr size_t COMPARE_CHUNK_SIZE = 1 << 20;
+
+/// Measurement of one stage on one corpus
+struct StageResult {
+  std::string name;     ///< Stage name
+  size_t bytes = 0;     ///< Bytes processed per run (0 if not a throughput)
+  double seconds = 0;   ///< Best wall time of one run
+  size_t peakRssKb = 0; ///< Peak resident size during the runs, in KiB
+};
+
+/// Measurements of every stage on one corpus
+struct CorpusResult {
+  std::string path;                ///< Corpus file
+  size_t bytes = 0;                ///< Uncompressed size
+  size_t compressedBytes = 0;      ///< Size of the .jcb file
+  size_t symbols = 0;              ///< Symbols of the table
+  bool roundTrip = false;          ///< Whether decompression gave the input back
+  std::vector<StageResult> stages; ///< Stages, in run order
+};
+
+/**
+ * @brief Measures a stage: best wall time of several runs and peak RSS
+ */
+template <typename Fn>
+static StageResult measure(const std::string &name, size_t bytes, int repeat, Fn &&fn) {
+  reset_peak_rss();
+  StageResult result;
+  result.name = name;
+  result.bytes = bytes;
+  result.seconds = best_time(repeat, fn);
+  result.peakRssKb = peak_rss_kb();
+  if (bytes > 0) {
+    report(name, bytes, result.seconds);
+  } else {
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+              << std::setprecision(3) << std::setw(10) << result.seconds * 1000 << " ms\n";
+  }
+  return result;
+}
+
+/**
+ * @brief Checks that two files hold the same bytes
+ */
+static bool same_content(const std::string &a, const std::string &b) {
+  if (fs::file_size(a) != fs::file_size(b)) return false;
+  std::ifstream first(a, std::ios::binary), second(b, std::ios::binary);
+  std::vector<char> x(COMPARE_CHUNK_SIZE), y(COMPARE_CHUNK_SIZE);
+  while (first and second) {
+    first.read(x.data(), static_cast<std::streamsize>(x.size()));
+    second.read(y.data(), static_cast<std::streamsize>(y.size()));
+    if (first.gcount() != second.gcount() or
+        not std::equal(x.begin(), x.begin() + first.gcount(), y.begin())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Escapes a string for a JSON document
+ */
+static std::string json_string(const std::string &text) {
+  std::string out = "\"";
+  for (char c : text) {
+    if (c == '"' or c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      std::ostringstream code;
+      code << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c);
+      out += code.str();
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+/**
+ * @brief Writes the results as a JSON document
+ */
+static void write_json(std::ostream &out, const std::vector<CorpusResult> &results,
+                       int repeat) {
+  out << std::fixed;
+  out << "{\n  \"repeat\": " << repeat << ",\n  \"corpora\": [";
+  for (size_t i = 0; i < results.size(); i++) {
+    const CorpusResult &corpus = results[i];
+    out << (i > 0 ? "," : "") << "\n    {\n"
+        << "      \"path\": " << json_string(corpus.path) << ",\n"
+        << "      \"bytes\": " << corpus.bytes << ",\n"
+        << "      \"compressed_bytes\": " << corpus.compressedBytes << ",\n"
+        << "      \"ratio\": " << std::setprecision(4)
+        << (corpus.bytes > 0 ? double(corpus.compressedBytes) / corpus.bytes : 0) << ",\n"
+        << "      \"symbols\": " << corpus.symbols << ",\n"
+        << "      \"round_trip\": " << (corpus.roundTrip ? "true" : "false") << ",\n"
+        << "      \"stages\": {";
+    for (size_t j = 0; j < corpus.stages.size(); j++) {
+      const StageResult &stage = corpus.stages[j];
+      out << (j > 0 ? "," : "") << "\n        " << json_string(stage.name) << ": {"
+          << "\"seconds\": " << std::setprecision(6) << stage.seconds;
+      if (stage.bytes > 0) {
+        const double mb = stage.bytes / (1024.0 * 1024.0);
+        out << ", \"mb_per_s\": " << std::setprecision(2)
+            << (stage.seconds > 0 ? mb / stage.seconds : 0);
+      }
+      out << ", \"peak_rss_kb\": " << stage.peakRssKb << "}";
+    }
+    out << "\n      }\n    }";
+  }
+  out << "\n  ]\n}\n";
+}
+
+int suite_bench(int argc, char *argv[]) {
+  std::string jsonPath = "-";
+  std::string workDir = fs::temp_directory_path().string();
+  std::string inputsDir = "inputs";
+  int repeat = 1;
+  std::vector<std::string> corpora;
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--json" and i + 1 < argc) {
+      jsonPath = argv[++i];
+    } else if (arg == "--repeat" and i + 1 < argc) {
+      repeat = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--work" and i + 1 < argc) {
+      workDir = argv[++i];
+    } else if (arg == "--inputs" and i + 1 < argc) {
+      inputsDir = argv[++i];
+    } else {
+      corpora.push_back(arg);
+    }
+  }
+  if (corpora.empty()) {
+    std::cerr << "Usage: suite [--json <file>] [--repeat <n>] [--work <dir>] "
+                 "[--inputs <dir>] <corpus>...\n";
+    return 1;
+  }
+  fs::create_directories(workDir);
+
+  std::vector<CorpusResult> results;
+  for (const std::string &path : corpora) {
+    CorpusResult corpus;
+    corpus.path = path;
+    corpus.bytes = fs::file_size(path);
+
+    // Intermediate files are named after the corpus, in the work directory
+    const std::string base = (fs::path(workDir) / fs::path(path).filename()).string();
+    const std::string tablePath = base + ".freq";
+    const std::string compressedPath = base + ".jcb";
+    const std::string decompressedPath = base + ".out";
+
+    std::cout << path << " (" << corpus.bytes << " bytes)\n";
+
+    // The table is counted as freq-table does, with the keyword and
+    // character lists of inputs/
+    corpus.stages.push_back(measure("table", corpus.bytes, repeat, [&] {
+      auto keywords = create_unordered_map_from_file(inputsDir + "/cpp-keywords.txt");
+      auto chars = create_unordered_map_from_file(inputsDir + "/ascii_chars.txt");
+      count_frequencies_in_various_files({path}, keywords, chars, 1);
+      create_frequency_table(tablePath, keywords, chars);
+    }));
+
+    corpus.stages.push_back(measure("tree", 0, repeat, [&] {
+      HuffmanTree tree(tablePath);
+      corpus.symbols = tree.getSymbols().size();
+    }));
+
+    Compressor compressor;
+    corpus.stages.push_back(measure("compress", corpus.bytes, repeat, [&] {
+      compressor.compress(path, compressedPath, tablePath);
+    }));
+    corpus.compressedBytes = fs::file_size(compressedPath);
+
+    Decompressor decompressor;
+    corpus.stages.push_back(measure("decompress", corpus.bytes, repeat, [&] {
+      decompressor.decompress(compressedPath, decompressedPath);
+    }));
+    corpus.roundTrip = same_content(path, decompressedPath);
+
+    std::cout << "ratio " << std::fixed << std::setprecision(4)
+              << (corpus.bytes > 0 ? double(corpus.compressedBytes) / corpus.bytes : 0)
+              << (corpus.roundTrip ? ", round trip ok\n" : ", ROUND TRIP MISMATCH\n");
+
+    fs::remove(compressedPath);
+    fs::remove(decompressedPath);
+    results.push_back(std::move(corpus));
+  }
+
+  if (jsonPath == "-") {
+    write_json(std::cout, results, repeat);
+  } else {
+    std::ofstream out(jsonPath);
+    if (not out.is_open()) throw std::runtime_error("Error opening " + jsonPath);
+    write_json(out, results, repeat);
+    std::cout << "Results written to " << jsonPath << "\n";
+  }
+
+  for (const CorpusResult &corpus : results) {
+    if (not corpus.roundTrip) return 1;
+  }
+  return 0;
+}
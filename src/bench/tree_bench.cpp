@@ -0,0 +1,102 @@
+/**
+ * @file tree_bench.cpp
+ * @brief Benchmark of Huffman tree construction: legacy shared_ptr graph
+ * versus the HuffmanTree node array
+ */
+#include "bench.hpp"
+#include "../sempress/huffman_tree.hpp"
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Node of the legacy tree, one heap allocation each
+struct LegacyNode {
+  std::string symbol;
+  uint64_t freq;
+  std::shared_ptr<LegacyNode> left, right;
+};
+
+/**
+ * @brief Builds the tree and the code table the way HuffmanTree used to
+ *
+ * Every node is a make_shared allocation, and the codes are generated by a
+ * recursion that copies a shared_ptr and a string at each step.
+ */
+static void legacy_codes(std::shared_ptr<LegacyNode> node, const std::string &code,
+                         std::unordered_map<std::string, std::string> &table) {
+  if (not node) return;
+  if (not node->left and not node->right) {
+    table[node->symbol] = code;
+  } else {
+    legacy_codes(node->left, code + "0", table);
+    legacy_codes(node->right, code + "1", table);
+  }
+}
+
+static std::unordered_map<std::string, std::string>
+legacy_build(const std::unordered_map<std::string, int> &freq) {
+  auto compare = [](const std::shared_ptr<LegacyNode> &a,
+                    const std::shared_ptr<LegacyNode> &b) { return a->freq > b->freq; };
+  std::priority_queue<std::shared_ptr<LegacyNode>,
+                      std::vector<std::shared_ptr<LegacyNode>>, decltype(compare)>
+      pq(compare);
+
+  for (const auto &[symbol, count] : freq) {
+    pq.push(std::make_shared<LegacyNode>(LegacyNode{symbol, static_cast<uint64_t>(count), nullptr, nullptr}));
+  }
+  while (pq.size() > 1) {
+    auto left = pq.top(); pq.pop();
+    auto right = pq.top(); pq.pop();
+    pq.push(std::make_shared<LegacyNode>(LegacyNode{"", left->freq + right->freq, left, right}));
+  }
+
+  std::unordered_map<std::string, std::string> table;
+  legacy_codes(pq.top(), "", table);
+  return table;
+}
+
+int tree_bench(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: tree <symbols> [repeat]\n";
+    return 1;
+  }
+  size_t count = std::stoul(argv[1]);
+  int repeat = argc > 2 ? std::stoi(argv[2]) : 3;
+
+  // Deterministic skewed frequencies (Zipf-like with a linear congruential
+  // generator jitter), like a large token alphabet
+  std::unordered_map<std::string, int> freq;
+  uint64_t state = 42;
+  for (size_t i = 0; i < count; i++) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    freq["sym" + std::to_string(i)] = static_cast<int>(1000000 / (i + 1) + (state >> 58));
+  }
+  freq[""] = 1;
+
+  std::unordered_map<std::string, std::string> legacy;
+  double legacySeconds = best_time(repeat, [&] { legacy = legacy_build(freq); });
+
+  HuffmanTree tree;
+  double arraySeconds = best_time(repeat, [&] { tree = HuffmanTree(freq); });
+
+  std::cout << "alphabet: " << freq.size() << " symbols, "
+            << tree.getNodes().size() << " nodes\n";
+  std::cout << "shared_ptr graph:  " << legacySeconds * 1000 << " ms\n";
+  std::cout << "node array:        " << arraySeconds * 1000 << " ms\n";
+  std::cout << "speedup: " << legacySeconds / arraySeconds << "x\n";
+
+  // Both must be optimal, so the total encoded size must match
+  uint64_t legacyBits = 0, arrayBits = 0;
+  for (const auto &[symbol, code] : legacy) legacyBits += code.length() * freq.at(symbol);
+  for (size_t id = 0; id < tree.getSymbols().size(); id++) {
+    arrayBits += tree.getCodes()[id].length * static_cast<uint64_t>(freq.at(tree.getSymbols()[id]));
+  }
+  if (legacyBits != arrayBits) {
+    std::cerr << "Encoded sizes differ: " << legacyBits << " vs " << arrayBits << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file bit_reader.hpp
+ * @brief Definition of the BitReader class, which reads a bit stream
+ * through a 64-bit register
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class BitReader
+ * @brief Peeks and consumes bits of an in-memory stream, most significant
+ * bit first, mirroring BitWriter
+ *
+ * The register is refilled a whole word at a time while enough input is
+ * left, so a decoder can peek several bits with a single shift. Bits past
+ * the end of the input read as zeros.
+ */
+class BitReader {
+public:
+  /**
+   * @brief Creates a reader over a byte buffer
+   *
+   * @param data Pointer to the first byte of the stream
+   * @param size Number of bytes of the stream
+   */
+  BitReader(const unsigned char *data, size_t size)
+      : next(data), end(data + size) {
+    refill();
+  }
+
+  /**
+   * @brief Tops up the register to at least 56 bits, or to the end of input
+   */
+  void refill() {
+    if (end - next >= 8) {
+      uint64_t word = 0;
+      for (int i = 0; i < 8; i++) word = (word << 8) | next[i];
+      // Bits past the claimed bytes are the same as the next refill would
+      // load, so or-ing them in early is harmless
+      buf |= word >> count;
+      unsigned take = (63 - count) >> 3;
+      next += take;
+      count += take * 8;
+      return;
+    }
+    while (count <= 56 and next != end) {
+      buf |= static_cast<uint64_t>(*next++) << (56 - count);
+      count += 8;
+    }
+  }
+
+  /**
+   * @brief Returns the next n bits without consuming them
+   *
+   * @param n Number of bits, from 1 to 56
+   * @return uint64_t The bits, right-aligned
+   */
+  uint64_t peek(unsigned n) const { return buf >> (64 - n); }
+
+  /**
+   * @brief Discards the next n bits
+   *
+   * @param n Number of bits, at most available()
+   */
+  void consume(unsigned n) {
+    buf <<= n;
+    count -= n;
+  }
+
+  /**
+   * @brief Returns the number of bits loaded in the register
+   *
+   * @return unsigned Bits that can be consumed before the next refill
+   */
+  unsigned available() const { return count; }
+
+  /**
+   * @brief Returns the number of bits not consumed yet
+   *
+   * @return uint64_t Bits left in the register and in the input
+   */
+  uint64_t bitsLeft() const {
+    return count + 8 * static_cast<uint64_t>(end - next);
+  }
+
+private:
+  const unsigned char *next; ///< Next byte to be loaded
+  const unsigned char *end;  ///< End of the input
+  uint64_t buf = 0;          ///< Loaded bits, aligned to the top
+  unsigned count = 0;        ///< Number of loaded bits
+};
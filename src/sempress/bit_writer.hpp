@@ -0,0 +1,116 @@
+/**
+ * @file bit_writer.hpp
+ * @brief Definition of the BitWriter class, which packs variable-length
+ * codes into bytes
+ */
+#pragma once
+#include "stats.hpp"
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * @class BitWriter
+ * @brief Accumulates codes in a 64-bit register and flushes whole words
+ *
+ * Bits are written most significant first, so the first bit of the first
+ * code is the highest bit of the first output byte. Completed words are
+ * appended to a contiguous byte buffer, which the caller drains to its
+ * output whenever it is convenient.
+ */
+class BitWriter {
+public:
+  /**
+   * @brief Appends a code to the bit stream
+   *
+   * @param bits Code right-aligned in the word (bits above length must be 0)
+   * @param length Number of bits of the code, from 0 to 64
+   */
+  void write(uint64_t bits, unsigned length) {
+    if (length == 0) return;
+    unsigned room = 64 - used;
+    if (length < room) {
+      acc |= bits << (room - length);
+      used += length;
+      return;
+    }
+    // The code fills the register: its leading bits complete the word
+    unsigned rest = length - room;
+    acc |= bits >> rest;
+    flushWord();
+    acc = rest ? bits << (64 - rest) : 0;
+    used = rest;
+  }
+
+  /**
+   * @brief Pads the pending bits with zeros up to the next byte boundary
+   *
+   * After this call every written bit is in the byte buffer.
+   */
+  void alignToByte() {
+    while (used > 0) {
+      bytes.push_back(static_cast<unsigned char>(acc >> 56));
+      acc <<= 8;
+      used = used > 8 ? used - 8 : 0;
+    }
+    acc = 0;
+  }
+
+  /**
+   * @brief Moves the complete bytes of the register to the byte buffer
+   *
+   * Fewer than 8 bits stay pending, so a live stream can hand out all it
+   * has encoded without padding.
+   */
+  void flushBytes() {
+    while (used >= 8) {
+      bytes.push_back(static_cast<unsigned char>(acc >> 56));
+      acc <<= 8;
+      used -= 8;
+    }
+  }
+
+  /**
+   * @brief Returns the completed bytes not yet drained
+   *
+   * @return const std::vector<unsigned char>& Byte buffer
+   */
+  const std::vector<unsigned char> &buffer() const { return bytes; }
+
+  /**
+   * @brief Returns the number of bits written since the writer was created
+   *
+   * @return uint64_t Bits written, drained ones included
+   */
+  uint64_t bitCount() const { return 8 * (drained + bytes.size()) + used; }
+
+  /**
+   * @brief Writes the completed bytes to a stream and clears the buffer
+   *
+   * @param out Output stream
+   */
+  void drainTo(std::ostream &out) {
+    Stats::PhaseTimer timer(Stats::IO);
+    out.write(reinterpret_cast<const char *>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+    drained += bytes.size();
+    bytes.clear();
+  }
+
+private:
+  std::vector<unsigned char> bytes; ///< Completed bytes
+  uint64_t acc = 0;                 ///< Pending bits, aligned to the top
+  unsigned used = 0;                ///< Number of pending bits in acc
+  uint64_t drained = 0;             ///< Bytes already written to a stream
+
+  /**
+   * @brief Appends the full register to the byte buffer (big-endian)
+   */
+  void flushWord() {
+    size_t at = bytes.size();
+    bytes.resize(at + 8);
+    for (int i = 0; i < 8; i++) {
+      bytes[at + i] = static_cast<unsigned char>(acc >> (56 - 8 * i));
+    }
+  }
+};
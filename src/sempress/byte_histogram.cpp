@@ -0,0 +1,53 @@
+/**
+ * @file byte_histogram.cpp
+ * @brief Implementation of the byte histogram kernel
+ */
+#include "byte_histogram.hpp"
+#include <algorithm>
+
+/// Bytes counted between two reductions; each 32-bit counter sees at most
+/// SLICE_SIZE / TABLES + 1 of them
+static constexpr size_t SLICE_SIZE = size_t{1} << 30;
+
+/**
+ * @brief Adds the occurrences of each byte value of a buffer to counts
+ *
+ * The bytes are loaded one by one: splitting wider loads with shifts, or
+ * loading 32-byte vectors and extracting their bytes, both measured
+ * slower, since every byte still needs its own increment (there is no
+ * scatter instruction to vectorize it).
+ *
+ * @param data Bytes to count
+ * @param size Number of bytes
+ * @param counts Counts by byte value, added to
+ */
+void ByteHistogram::count(const unsigned char *data, size_t size, uint64_t counts[256]) {
+  static_assert(TABLES == 8, "the counting loop is unrolled for 8 tables");
+  uint32_t tables[TABLES][256];
+
+  while (size > 0) {
+    const size_t slice = std::min(size, SLICE_SIZE);
+    std::fill(&tables[0][0], &tables[0][0] + TABLES * 256, 0);
+
+    size_t i = 0;
+    for (; i + TABLES <= slice; i += TABLES) {
+      tables[0][data[i]]++;
+      tables[1][data[i + 1]]++;
+      tables[2][data[i + 2]]++;
+      tables[3][data[i + 3]]++;
+      tables[4][data[i + 4]]++;
+      tables[5][data[i + 5]]++;
+      tables[6][data[i + 6]]++;
+      tables[7][data[i + 7]]++;
+    }
+    for (; i < slice; i++) tables[0][data[i]]++;
+
+    for (unsigned byte = 0; byte < 256; byte++) {
+      uint64_t sum = 0;
+      for (unsigned table = 0; table < TABLES; table++) sum += tables[table][byte];
+      counts[byte] += sum;
+    }
+    data += slice;
+    size -= slice;
+  }
+}
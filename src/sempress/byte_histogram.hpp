@@ -0,0 +1,36 @@
+/**
+ * @file byte_histogram.hpp
+ * @brief Definition of the ByteHistogram class, which counts the byte
+ * values of a buffer
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class ByteHistogram
+ * @brief Counting kernel for the occurrences of each byte value
+ *
+ * Consecutive bytes are counted into TABLES separate arrays in turn, so
+ * a run of equal bytes does not make each increment wait for the store of
+ * the previous one; the arrays are added up at the end. The counters of
+ * the arrays are 32-bit, so they stay in the L1 cache, and the input is
+ * counted in slices small enough that they cannot overflow.
+ *
+ * All methods are static, so instantiation of the class is not required
+ * for use.
+ */
+class ByteHistogram {
+public:
+  /// Arrays counted in turn
+  static constexpr unsigned TABLES = 8;
+
+  /**
+   * @brief Adds the occurrences of each byte value of a buffer to counts
+   *
+   * @param data Bytes to count
+   * @param size Number of bytes
+   * @param counts Counts by byte value, added to
+   */
+  static void count(const unsigned char *data, size_t size, uint64_t counts[256]);
+};
@@ -0,0 +1,39 @@
+/**
+ * @file byte_order.hpp
+ * @brief Little-endian integer helpers shared by the binary file formats
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Appends a 32-bit little-endian integer to a string
+ */
+inline void putUint32(std::string &bytes, uint32_t value) {
+  for (int i = 0; i < 4; i++) bytes += static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+/**
+ * @brief Decodes a 32-bit little-endian integer
+ */
+inline uint32_t getUint32(const unsigned char *bytes) {
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; i--) value = (value << 8) | bytes[i];
+  return value;
+}
+
+/**
+ * @brief Appends a 64-bit little-endian integer to a string
+ */
+inline void putUint64(std::string &bytes, uint64_t value) {
+  for (int i = 0; i < 8; i++) bytes += static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+/**
+ * @brief Decodes a 64-bit little-endian integer
+ */
+inline uint64_t getUint64(const unsigned char *bytes) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; i--) value = (value << 8) | bytes[i];
+  return value;
+}
@@ -0,0 +1,253 @@
+/**
+ * @file codec.cpp
+ * @brief Implementation of the in-memory codec
+ */
+#include "codec.hpp"
+#include "bit_reader.hpp"
+#include "bit_writer.hpp"
+#include "compiled_table.hpp"
+#include "stats.hpp"
+#include "token_parser.hpp"
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * @class BufferWriter
+ * @brief Packs codes into a buffer given by the caller, as BitWriter does
+ * into its own
+ */
+class BufferWriter {
+public:
+  /**
+   * @brief Creates a writer over a buffer
+   *
+   * @param out Destination buffer
+   * @param capacity Size of the destination buffer
+   */
+  BufferWriter(unsigned char *out, size_t capacity)
+      : start(out), next(out), end(out + capacity) {}
+
+  /**
+   * @brief Appends a code to the bit stream
+   *
+   * @param bits Code right-aligned in the word (bits above length must be 0)
+   * @param length Number of bits of the code, from 0 to 64
+   * @throws std::runtime_error If the buffer is full
+   */
+  void write(uint64_t bits, unsigned length) {
+    if (length == 0) return;
+    unsigned room = 64 - used;
+    if (length < room) {
+      acc |= bits << (room - length);
+      used += length;
+      return;
+    }
+    unsigned rest = length - room;
+    acc |= bits >> rest;
+    store(8);
+    acc = rest ? bits << (64 - rest) : 0;
+    used = rest;
+  }
+
+  /**
+   * @brief Pads the pending bits with zeros up to the next byte boundary
+   *
+   * @return size_t Number of bytes written to the buffer
+   * @throws std::runtime_error If the buffer is full
+   */
+  size_t alignToByte() {
+    store((used + 7) / 8);
+    used = 0;
+    return static_cast<size_t>(next - start);
+  }
+
+private:
+  unsigned char *start; ///< First byte of the buffer
+  unsigned char *next;  ///< Next byte to be written
+  unsigned char *end;   ///< End of the buffer
+  uint64_t acc = 0;     ///< Pending bits, aligned to the top
+  unsigned used = 0;    ///< Number of pending bits in acc
+
+  /**
+   * @brief Writes the leading bytes of the register (big-endian)
+   *
+   * @param count Number of bytes, at most 8
+   */
+  void store(unsigned count) {
+    if (static_cast<size_t>(end - next) < count) {
+      throw std::runtime_error("Output buffer too small.");
+    }
+    for (unsigned i = 0; i < count; i++) {
+      *next++ = static_cast<unsigned char>(acc >> (56 - 8 * i));
+    }
+    acc = 0;
+  }
+};
+
+/**
+ * @brief Encodes a buffer and its end-of-file code
+ *
+ * @param writer Bit writer receiving the codes
+ * @param parser Codes, trie and parse strategy
+ * @param data First byte to compress
+ * @param size Number of bytes
+ * @return uint32_t Size the bit stream decodes to (skipped bytes excluded)
+ * @throws std::runtime_error If the input is too large
+ */
+template <typename Writer>
+static uint32_t encodeBuffer(Writer &writer, const Parser &parser,
+                             const char *data, size_t size) {
+  if (size > Codec::MAX_BUFFER_SIZE) throw std::runtime_error("Input buffer too large.");
+
+  const std::vector<HuffmanCode> &codes = parser.tree.getCodes();
+  size_t skipped = 0;
+  scanTokens(parser, data, size, size, skipped, [&](int symbol) {
+    writer.write(codes[symbol].bits, codes[symbol].length);
+  });
+  const HuffmanCode &eof = codes[parser.tree.getEofSymbol()];
+  writer.write(eof.bits, eof.length);
+  return static_cast<uint32_t>(size - skipped);
+}
+
+/**
+ * @brief Writes the uncompressed size at the start of a compressed buffer
+ *
+ * @param out First byte of the compressed buffer
+ * @param rawSize Uncompressed size
+ */
+static void storeSize(unsigned char *out, uint32_t rawSize) {
+  for (size_t i = 0; i < Codec::SIZE_BYTES; i++) {
+    out[i] = static_cast<unsigned char>((rawSize >> (8 * i)) & 0xFF);
+  }
+}
+
+Codec::Codec(const std::string &tablePath, const CodecOptions &options)
+    : Codec(load(tablePath, options.maxCodeLength), options) {}
+
+Codec::Codec(std::unordered_map<std::string, int> freq, const CodecOptions &options)
+    : Codec(build(std::move(freq), options.maxCodeLength), options) {}
+
+Codec::Codec(Table table, const CodecOptions &options)
+    : tree(std::move(table.first)), matcher(std::move(table.second)), decoder(tree),
+      optimal(options.optimalParse) {
+  if (tree.getMaxCodeLength() > HuffmanCode::MAX_PACKED_LENGTH) {
+    throw std::runtime_error("Codes longer than " +
+                             std::to_string(HuffmanCode::MAX_PACKED_LENGTH) +
+                             " bits; build the codec with a maximum code length.");
+  }
+}
+
+Codec::Table Codec::load(const std::string &tablePath, unsigned maxCodeLength) {
+  Table table;
+  loadTable(tablePath, maxCodeLength, table.first, table.second);
+  return table;
+}
+
+Codec::Table Codec::build(std::unordered_map<std::string, int> freq,
+                          unsigned maxCodeLength) {
+  Table table;
+  table.first = HuffmanTree(std::move(freq), maxCodeLength);
+  table.second = TokenMatcher(table.first.getSymbols());
+  return table;
+}
+
+/**
+ * @brief Loads the codes and the token trie of a table
+ *
+ * @param tablePath Path to the text or compiled table
+ * @param maxCodeLength Longest code allowed; 0 for no limit
+ * @param tree Receives the codes
+ * @param matcher Receives the token trie
+ * @throws std::runtime_error If the table cannot be read, or a compiled
+ *         table has longer codes
+ */
+void Codec::loadTable(const std::string &tablePath, unsigned maxCodeLength,
+                      HuffmanTree &tree, TokenMatcher &matcher) {
+  Stats::PhaseTimer timer(Stats::TABLE_LOAD);
+  if (not CompiledTable::load(tablePath, tree, matcher)) {
+    tree = HuffmanTree(tablePath, maxCodeLength);
+    matcher = TokenMatcher(tree.getSymbols());
+  } else if (maxCodeLength > 0 and tree.getMaxCodeLength() > maxCodeLength) {
+    // The frequencies are not stored, so the codes cannot be rebuilt
+    throw std::runtime_error("Compiled table has codes longer than " +
+                             std::to_string(maxCodeLength) +
+                             " bits; compile it with that limit.");
+  }
+}
+
+size_t Codec::compressBound(size_t size) const {
+  return SIZE_BYTES + ((size + 1) * tree.getMaxCodeLength() + 7) / 8;
+}
+
+std::vector<unsigned char> Codec::compress(const char *data, size_t size) const {
+  BitWriter writer;
+  const uint32_t rawSize = encodeBuffer(writer, {tree, matcher, optimal}, data, size);
+  writer.alignToByte();
+
+  std::vector<unsigned char> compressed(SIZE_BYTES + writer.buffer().size());
+  storeSize(compressed.data(), rawSize);
+  std::memcpy(compressed.data() + SIZE_BYTES, writer.buffer().data(), writer.buffer().size());
+  return compressed;
+}
+
+size_t Codec::compress(const char *data, size_t size, unsigned char *out,
+                       size_t capacity) const {
+  if (capacity < SIZE_BYTES) throw std::runtime_error("Output buffer too small.");
+
+  BufferWriter writer(out + SIZE_BYTES, capacity - SIZE_BYTES);
+  storeSize(out, encodeBuffer(writer, {tree, matcher, optimal}, data, size));
+  return SIZE_BYTES + writer.alignToByte();
+}
+
+size_t Codec::decompressedSize(const unsigned char *data, size_t size) {
+  if (size < SIZE_BYTES) throw std::runtime_error("Corrupted compressed buffer.");
+  uint32_t rawSize = 0;
+  for (size_t i = 0; i < SIZE_BYTES; i++) rawSize |= static_cast<uint32_t>(data[i]) << (8 * i);
+  return rawSize;
+}
+
+std::vector<char> Codec::decompress(const unsigned char *data, size_t size) const {
+  std::vector<char> decoded(decompressedSize(data, size));
+  decompress(data, size, decoded.data(), decoded.size());
+  return decoded;
+}
+
+/**
+ * @brief Decompresses a buffer into one given by the caller
+ *
+ * The lookup decoder copies padded symbols while they fit in the output;
+ * the last few symbols are then copied one by one at their exact size, so
+ * the output needs no room past the data.
+ *
+ * @param data First byte of the compressed buffer
+ * @param size Number of bytes
+ * @param out Destination buffer
+ * @param capacity Size of the destination buffer
+ * @return size_t Number of bytes written to out
+ * @throws std::runtime_error If the buffer is corrupted or the output
+ *         does not fit
+ */
+size_t Codec::decompress(const unsigned char *data, size_t size, char *out,
+                         size_t capacity) const {
+  const size_t rawSize = decompressedSize(data, size);
+  if (capacity < rawSize) throw std::runtime_error("Output buffer too small.");
+
+  BitReader reader(data + SIZE_BYTES, size - SIZE_BYTES);
+  HuffmanDecoder::Stop stop;
+  size_t written = decoder.decodeInto(reader, out, rawSize, stop);
+  if (stop == HuffmanDecoder::END_OF_BITS) throw std::runtime_error("Corrupted compressed buffer.");
+
+  const std::vector<std::string> &symbols = decoder.getSymbols();
+  while (stop == HuffmanDecoder::MORE) {
+    const int symbol = decoder.decode(reader);
+    if (symbol == decoder.getEofSymbol()) break;
+    if (symbol == HuffmanDecoder::NO_SYMBOL or symbols[symbol].size() > rawSize - written) {
+      throw std::runtime_error("Corrupted compressed buffer.");
+    }
+    std::memcpy(out + written, symbols[symbol].data(), symbols[symbol].size());
+    written += symbols[symbol].size();
+  }
+
+  if (written != rawSize) throw std::runtime_error("Corrupted compressed buffer.");
+  return written;
+}
@@ -0,0 +1,213 @@
+/**
+ * @file codec.hpp
+ * @brief Definition of the Codec class, which compresses and decompresses
+ * in-memory buffers with codes loaded once
+ */
+#pragma once
+#include "huffman_decoder.hpp"
+#include "huffman_tree.hpp"
+#include "token_matcher.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct CodecOptions
+ * @brief Settings of a codec, fixed when it is built
+ */
+struct CodecOptions {
+  /// Chooses the tokens with the fewest encoded bits instead of the longest
+  /// match at each position; slower, but the output is smaller
+  bool optimalParse = false;
+
+  /// Longest code built from a text table or from frequencies; 0 for no limit
+  unsigned maxCodeLength = 0;
+};
+
+/**
+ * @class Codec
+ * @brief Buffer-to-buffer compression with the codes of one table
+ *
+ * The table is loaded, and the token trie and decoding tables are built,
+ * once in the constructor; compress() and decompress() only read them, so
+ * one codec can be shared by any number of threads. The overloads writing
+ * into a buffer given by the caller allocate nothing (apart from the
+ * window of the optimal parse, allocated once per thread).
+ *
+ * A compressed buffer is not a .jcb file: it holds no codes, only the
+ * uncompressed size (4 bytes, little-endian) followed by the bit stream,
+ * ending with the end-of-file code and padded to a byte. Both ends must
+ * build their codec from the same table. As in the file compressor, input
+ * bytes without a code in the table are dropped, and the recorded size
+ * excludes them.
+ */
+class Codec {
+public:
+  /// Bytes before the bit stream of a compressed buffer
+  static constexpr size_t SIZE_BYTES = 4;
+
+  /// Largest uncompressed size of a buffer
+  static constexpr uint64_t MAX_BUFFER_SIZE = UINT32_MAX;
+
+  /**
+   * @brief Creates a codec from a table file
+   *
+   * @param tablePath Path to the text table, or to a table compiled by
+   *        Compressor::compileTable()
+   * @param options Parse strategy and code length limit
+   *
+   * @throws std::runtime_error If the table cannot be loaded, or has codes
+   *         too long to be packed (see CodecOptions::maxCodeLength)
+   */
+  explicit Codec(const std::string &tablePath, const CodecOptions &options = CodecOptions());
+
+  /**
+   * @brief Creates a codec from in-memory frequencies
+   *
+   * @param freq Symbols and their frequencies
+   * @param options Parse strategy and code length limit
+   *
+   * @throws std::runtime_error If the codes are too long to be packed
+   */
+  explicit Codec(std::unordered_map<std::string, int> freq,
+                 const CodecOptions &options = CodecOptions());
+
+  /**
+   * @brief Returns the largest compressed size of an input
+   *
+   * Every token covers at least one byte and no code is longer than the
+   * longest one, so a buffer of this size always holds the output.
+   *
+   * @param size Uncompressed size
+   * @return size_t Bytes a compressed buffer may need
+   */
+  size_t compressBound(size_t size) const;
+
+  /**
+   * @brief Compresses a buffer into a new one
+   *
+   * @param data First byte to compress
+   * @param size Number of bytes
+   * @return std::vector<unsigned char> Compressed buffer
+   *
+   * @throws std::runtime_error If the input is larger than MAX_BUFFER_SIZE
+   */
+  std::vector<unsigned char> compress(const char *data, size_t size) const;
+
+  /**
+   * @brief Compresses a buffer into one given by the caller
+   *
+   * @param data First byte to compress
+   * @param size Number of bytes
+   * @param out Destination buffer
+   * @param capacity Size of the destination buffer; compressBound(size)
+   *        is always enough
+   * @return size_t Number of bytes written to out
+   *
+   * @throws std::runtime_error If the input is larger than MAX_BUFFER_SIZE
+   *         or the output does not fit
+   */
+  size_t compress(const char *data, size_t size, unsigned char *out,
+                  size_t capacity) const;
+
+  /**
+   * @brief Reads the uncompressed size recorded in a compressed buffer
+   *
+   * @param data First byte of the compressed buffer
+   * @param size Number of bytes
+   * @return size_t Size of the buffer once decompressed
+   *
+   * @throws std::runtime_error If the buffer is too short
+   */
+  static size_t decompressedSize(const unsigned char *data, size_t size);
+
+  /**
+   * @brief Decompresses a buffer into a new one
+   *
+   * @param data First byte of the compressed buffer
+   * @param size Number of bytes
+   * @return std::vector<char> Decompressed bytes
+   *
+   * @throws std::runtime_error If the buffer is corrupted
+   */
+  std::vector<char> decompress(const unsigned char *data, size_t size) const;
+
+  /**
+   * @brief Decompresses a buffer into one given by the caller
+   *
+   * @param data First byte of the compressed buffer
+   * @param size Number of bytes
+   * @param out Destination buffer
+   * @param capacity Size of the destination buffer, at least
+   *        decompressedSize(data, size)
+   * @return size_t Number of bytes written to out
+   *
+   * @throws std::runtime_error If the buffer is corrupted or the output
+   *         does not fit
+   */
+  size_t decompress(const unsigned char *data, size_t size, char *out,
+                    size_t capacity) const;
+
+  /**
+   * @brief Returns the codes of the codec
+   *
+   * @return const HuffmanTree& Tree holding the codes
+   */
+  const HuffmanTree &getTree() const { return tree; }
+
+  /**
+   * @brief Loads the codes and the token trie of a table
+   *
+   * Compiled tables hold both ready to use; text tables are parsed, and
+   * their symbols compiled into a trie.
+   *
+   * @param tablePath Path to the text or compiled table
+   * @param maxCodeLength Longest code allowed; 0 for no limit
+   * @param tree Receives the codes
+   * @param matcher Receives the token trie
+   * @throws std::runtime_error If the table cannot be read, or a compiled
+   *         table has longer codes
+   */
+  static void loadTable(const std::string &tablePath, unsigned maxCodeLength,
+                        HuffmanTree &tree, TokenMatcher &matcher);
+
+private:
+  HuffmanTree tree;       ///< Codes of the table
+  TokenMatcher matcher;   ///< Trie compiled from the symbols of the tree
+  HuffmanDecoder decoder; ///< Lookup tables built from the codes
+  bool optimal;           ///< Chooses tokens by encoded size instead of length
+
+  /// Codes of a table and the trie of its symbols, before the codec is built
+  using Table = std::pair<HuffmanTree, TokenMatcher>;
+
+  /**
+   * @brief Creates a codec from loaded codes
+   *
+   * @param table Codes and token trie
+   * @param options Parse strategy
+   * @throws std::runtime_error If the codes are too long to be packed
+   */
+  Codec(Table table, const CodecOptions &options);
+
+  /**
+   * @brief Loads a table file
+   *
+   * @param tablePath Path to the text or compiled table
+   * @param maxCodeLength Longest code allowed; 0 for no limit
+   * @return Table Codes and token trie
+   */
+  static Table load(const std::string &tablePath, unsigned maxCodeLength);
+
+  /**
+   * @brief Builds the codes of in-memory frequencies
+   *
+   * @param freq Symbols and their frequencies
+   * @param maxCodeLength Longest code allowed; 0 for no limit
+   * @return Table Codes and token trie
+   */
+  static Table build(std::unordered_map<std::string, int> freq, unsigned maxCodeLength);
+};
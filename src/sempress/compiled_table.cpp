@@ -0,0 +1,122 @@
+/**
+ * @file compiled_table.cpp
+ * @brief Implementation of the .jct compiled table reader and writer
+ */
+#include "compiled_table.hpp"
+#include "byte_order.hpp"
+#include "mapped_file.hpp"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+static const char MAGIC[3] = {'J', 'C', 'T'};
+
+/**
+ * @brief Computes the 32-bit FNV-1a hash of a byte range
+ */
+static uint32_t checksum(const unsigned char *data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; i++) hash = (hash ^ data[i]) * 16777619u;
+  return hash;
+}
+
+/**
+ * @brief Appends a 16-bit little-endian integer to a string
+ */
+static void putUint16(std::string &bytes, uint16_t value) {
+  bytes += static_cast<char>(value & 0xFF);
+  bytes += static_cast<char>(value >> 8);
+}
+
+void CompiledTable::write(const std::string &path, const HuffmanTree &tree,
+                          const TokenMatcher &matcher) {
+  const std::vector<std::string> &symbols = tree.getSymbols();
+  const std::vector<HuffmanCode> &codes = tree.getCodes();
+
+  std::string bytes(MAGIC, sizeof(MAGIC));
+  bytes += static_cast<char>(VERSION);
+  putUint32(bytes, static_cast<uint32_t>(symbols.size()));
+  for (size_t id = 0; id < symbols.size(); id++) {
+    if (symbols[id].length() > UINT16_MAX) {
+      throw std::runtime_error("Symbol too long for a compiled table.");
+    }
+    putUint16(bytes, codes[id].length);
+    putUint16(bytes, static_cast<uint16_t>(symbols[id].length()));
+    bytes += symbols[id];
+  }
+  matcher.save(bytes);
+  putUint32(bytes, checksum(reinterpret_cast<const unsigned char *>(bytes.data()), bytes.size()));
+
+  std::ofstream out(path, std::ios::binary);
+  if (not out.is_open()) throw std::runtime_error("Error opening " + path + ".");
+  out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  if (not out.flush()) throw std::runtime_error("Error writing " + path + ".");
+}
+
+/**
+ * @brief Loads a compiled table, if the file is one
+ *
+ * The file is mapped and its checksum verified before anything else is
+ * read; files that cannot be mapped are read into memory instead.
+ *
+ * @param path Path to the table
+ * @param tree Receives the codes
+ * @param matcher Receives the token trie
+ * @return true if the file was a compiled table
+ *
+ * @throws std::runtime_error If the file cannot be read, or is a
+ *         compiled table that is damaged or of an unknown version
+ */
+bool CompiledTable::load(const std::string &path, HuffmanTree &tree,
+                         TokenMatcher &matcher) {
+  MappedFile mapped(path);
+  std::string buffer;
+  std::string_view file = mapped.view();
+  if (not mapped.isMapped()) {
+    std::ifstream in(path, std::ios::binary);
+    if (not in.is_open()) throw std::runtime_error("Error opening table: " + path);
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    file = buffer;
+  }
+
+  if (file.size() < sizeof(MAGIC) or file.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0) {
+    return false;
+  }
+
+  const auto *data = reinterpret_cast<const unsigned char *>(file.data());
+  const size_t size = file.size();
+  auto damaged = [&] { return std::runtime_error("Damaged compiled table: " + path); };
+
+  if (size < 12 or checksum(data, size - 4) != getUint32(data + size - 4)) throw damaged();
+  if (data[3] != VERSION) {
+    throw std::runtime_error("Unsupported compiled table version " +
+                             std::to_string(data[3]) + ".");
+  }
+
+  const size_t end = size - 4;
+  const size_t count = getUint32(data + 4);
+  if (count > end) throw damaged();
+  std::vector<std::string> symbols(count);
+  std::vector<unsigned> lengths(count);
+
+  size_t pos = 8;
+  for (size_t id = 0; id < count; id++) {
+    if (end - pos < 4) throw damaged();
+    lengths[id] = data[pos] | (data[pos + 1] << 8);
+    size_t length = data[pos + 2] | (data[pos + 3] << 8);
+    pos += 4;
+    if (end - pos < length) throw damaged();
+    symbols[id].assign(file.data() + pos, length);
+    pos += length;
+  }
+
+  // Symbols are stored in canonical order, so the codes are assigned in a
+  // single pass without building a tree
+  tree = HuffmanTree(symbols, lengths);
+  if (tree.getSymbols() != symbols) throw damaged();
+  pos += matcher.load(data + pos, end - pos, count);
+  if (pos != end) throw damaged();
+  return true;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file compiled_table.hpp
+ * @brief Definition of the CompiledTable class, which reads and writes
+ * precompiled (.jct) frequency tables
+ */
+#pragma once
+#include "huffman_tree.hpp"
+#include "token_matcher.hpp"
+#include <cstdint>
+#include <string>
+
+/**
+ * @class CompiledTable
+ * @brief Utility class for binary tables holding ready-to-use codes
+ *
+ * Loading a text frequency table means parsing every line, building the
+ * Huffman tree and compiling the token trie. A compiled table stores the
+ * result instead, so compressing many small files does not pay for it on
+ * every run.
+ *
+ * Layout (integers are little-endian):
+ * - magic: the 3 bytes "JCT"
+ * - version: 1 byte
+ * - symbol count: 4 bytes
+ * - for each symbol, in canonical order:
+ *   - code length: 2 bytes
+ *   - symbol length: 2 bytes (0 for the end-of-file symbol)
+ *   - symbol bytes
+ * - the token trie (see TokenMatcher::save)
+ * - checksum: 4 bytes, FNV-1a of everything before it
+ *
+ * The file is memory-mapped when loaded. The decode tables are not stored:
+ * decompression rebuilds them from the header of the compressed file.
+ *
+ * All methods are static, so instantiation of the class is not required.
+ */
+class CompiledTable {
+public:
+  static constexpr uint8_t VERSION = 1; ///< Version written by this build
+
+  /**
+   * @brief Writes the codes of a tree and its token trie
+   *
+   * @param path Output file path
+   * @param tree Huffman tree holding the codes
+   * @param matcher Trie compiled from the symbols of the tree
+   *
+   * @throws std::runtime_error If the file cannot be written
+   */
+  static void write(const std::string &path, const HuffmanTree &tree,
+                    const TokenMatcher &matcher);
+
+  /**
+   * @brief Loads a compiled table, if the file is one
+   *
+   * @param path Path to the table
+   * @param tree Receives the codes
+   * @param matcher Receives the token trie
+   * @return true if the file was a compiled table, false if it does not
+   *         start with the compiled table magic (e.g. a text table)
+   *
+   * @throws std::runtime_error If the file cannot be read, or is a
+   *         compiled table that is damaged or of an unknown version
+   */
+  static bool load(const std::string &path, HuffmanTree &tree,
+                   TokenMatcher &matcher);
+};
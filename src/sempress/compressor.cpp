@@ -4,98 +4,651 @@
  */
 #include "compressor.hpp"
 #include "huffman_tree.hpp"
+#include "bit_writer.hpp"
+#include "byte_order.hpp"
+#include "codec.hpp"
+#include "compiled_table.hpp"
+#include "dynamic_model.hpp"
+#include "huffman_decoder.hpp"
+#include "input_window.hpp"
+#include "jcb_format.hpp"
+#include "mapped_file.hpp"
+#include "stats.hpp"
+#include "stream_io.hpp"
+#include "table_selector.hpp"
+#include "thread_pool.hpp"
+#include "token_matcher.hpp"
+#include "token_parser.hpp"
 #include "../table/frequency-table.hpp"
-#include <bitset>
 #include <vector>
 #include <algorithm>
-#include <sstream>
-#include <iterator>
+#include <deque>
+#include <string_view>
+
+/// Number of completed bytes kept by the bit writer before writing them out
+static constexpr size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+
+/// Size of the window through which the input is read
+static constexpr size_t INPUT_WINDOW_SIZE = 1 << 20;
 
 /**
- * @brief Compresses a file using Huffman encoding
+ * @brief Writes the code of a symbol
  *
- * The function uses an external frequency table. Thus, the output file
- * contains only the compressed data.
+ * Packed codes go straight to the bit writer. Codes that do not fit in a
+ * packed word are written from their string form in 64-bit pieces.
  *
- * @param inputFile Path to the input file to be compressed
- * @param outputFile Path to the compressed output file
- * @param tablePath Path to the external frequency table
- * @throws std::runtime_error If unable to open input/output files
+ * @param writer Bit writer receiving the code
+ * @param tree Huffman tree holding the codes
+ * @param symbol Id of the symbol
  */
-void Compressor::compress(const std::string &inputFile,
-              const std::string &outputFile,
-              const std::string &tablePath) {
-  HuffmanTree tree(tablePath);
-  auto codeTable = tree.getCodeTable();
-  
-  // Opens input and output files
-  std::ifstream in(inputFile);
-  std::ofstream out(outputFile, std::ios::binary);
-
-  if (not in.is_open() or not out.is_open())
-  throw std::runtime_error("Error opening files for compression.");
-
-  // Reads the entire file content into memory
-  std::stringstream file_buffer;
-  file_buffer << in.rdbuf();
-  std::string file_content = file_buffer.str();
-  in.close();
-
-  // Extracts the keys (tokens) from the code table and sorts by length (largest to smallest)
-  std::vector<std::string> tokens;
-  for (const auto &pair : codeTable) {
-    tokens.push_back(pair.first);
-  }
-
-  std::sort(tokens.begin(), tokens.end(), [](const std::string &a, const std::string &b) {
-    return a.length() > b.length();
+static void writeSymbol(BitWriter &writer, const HuffmanTree &tree, int symbol) {
+  const HuffmanCode &code = tree.getCodes()[symbol];
+  if (code.isPacked()) {
+    writer.write(code.bits, code.length);
+    return;
+  }
+
+  const std::string bits = tree.getCodeString(symbol);
+  for (size_t start = 0; start < bits.length(); start += 64) {
+    size_t end = std::min(bits.length(), start + 64);
+    uint64_t word = 0;
+    for (size_t i = start; i < end; i++) word = (word << 1) | (bits[i] == '1');
+    writer.write(word, static_cast<unsigned>(end - start));
+  }
+}
+
+/**
+ * @brief Encodes the tokens starting before a limit
+ *
+ * @param writer Bit writer receiving the codes
+ * @param parser Codes, trie and parse strategy
+ * @param data First byte to encode
+ * @param limit Tokens may only start before this position
+ * @param size Bytes available from data, for the matches
+ * @param skipped Incremented by the number of bytes skipped
+ * @return size_t Position after the last encoded token
+ */
+static size_t encodeTokens(BitWriter &writer, const Parser &parser,
+                           const char *data, size_t limit, size_t size,
+                           size_t &skipped) {
+  return scanTokens(parser, data, limit, size, skipped,
+                    [&](int symbol) { writeSymbol(writer, parser.tree, symbol); });
+}
+
+/**
+ * @brief Encodes one independent block
+ *
+ * @param parser Codes, trie and parse strategy
+ * @param block Uncompressed bytes of the block
+ * @return std::pair<size_t, std::vector<unsigned char>> Size the block
+ *         decodes to (skipped characters excluded) and its bit stream,
+ *         ending with the end-of-file code
+ */
+static std::pair<size_t, std::vector<unsigned char>>
+encodeBlock(const Parser &parser, std::string_view block) {
+  BitWriter writer;
+  size_t skipped = 0;
+  encodeTokens(writer, parser, block.data(), block.size(), block.size(), skipped);
+  writeSymbol(writer, parser.tree, parser.tree.getEofSymbol());
+  writer.alignToByte();
+  return {block.size() - skipped, writer.buffer()};
+}
+
+/**
+ * @brief Encodes one independent block as interleaved bit streams
+ *
+ * Token i goes to stream i % INTERLEAVE, so the decoder can decode one
+ * token of each stream per step. The payload starts with the token count
+ * and the sizes of all streams but the last (4 bytes each), followed by
+ * the byte-aligned streams; no end-of-file code is needed.
+ *
+ * @param parser Codes, trie and parse strategy
+ * @param block Uncompressed bytes of the block
+ * @return std::pair<size_t, std::vector<unsigned char>> Size the block
+ *         decodes to (skipped characters excluded) and its payload
+ */
+static std::pair<size_t, std::vector<unsigned char>>
+encodeInterleavedBlock(const Parser &parser, std::string_view block) {
+  constexpr unsigned STREAMS = HuffmanDecoder::INTERLEAVE;
+  BitWriter writers[STREAMS];
+  uint32_t count = 0;
+  size_t skipped = 0;
+  scanTokens(parser, block.data(), block.size(), block.size(), skipped, [&](int symbol) {
+    writeSymbol(writers[count++ % STREAMS], parser.tree, symbol);
   });
-  
-  std::string buffer; // Buffer to accumulate bits
-  size_t pos = 0;
-  while (pos < file_content.length()) {
-    std::string matched_token = "";
-    // Finds the largest token that matches the current position
-    for (const auto &token : tokens) {
-      if (file_content.substr(pos, token.length()) == token) {
-        matched_token = token;
-        break;
+
+  std::string jump;
+  putUint32(jump, count);
+  for (BitWriter &writer : writers) writer.alignToByte();
+  for (unsigned i = 0; i + 1 < STREAMS; i++) {
+    putUint32(jump, static_cast<uint32_t>(writers[i].buffer().size()));
+  }
+
+  std::vector<unsigned char> payload(jump.begin(), jump.end());
+  for (const BitWriter &writer : writers) {
+    payload.insert(payload.end(), writer.buffer().begin(), writer.buffer().end());
+  }
+  return {block.size() - skipped, std::move(payload)};
+}
+
+/**
+ * @brief Builds the codes from the symbols counted in the input itself
+ *
+ * The multi-character symbols of the table are the candidates, and every
+ * byte of the input is counted, so no character is left without a code.
+ * Symbols never taken are left out. Each byte of a counted symbol keeps a
+ * code of its own, so any other split of the input (at a block boundary,
+ * or by the optimal parse) is still encodable.
+ *
+ * @param inputFile Path to the input file (read once here, again to encode)
+ * @param candidates Symbols proposed by the table, if any
+ * @param maxCodeLength Longest code allowed; 0 for no limit
+ * @param tree Receives the codes
+ * @param matcher Receives the token trie
+ * @throws std::runtime_error If the input is stdin or cannot be read
+ */
+static void adaptTable(const std::string &inputFile,
+                       const std::vector<std::string> &candidates,
+                       unsigned maxCodeLength, HuffmanTree &tree,
+                       TokenMatcher &matcher) {
+  if (StreamIO::isStandard(inputFile)) {
+    throw std::runtime_error("Adaptive mode reads the input twice; it needs a file, not stdin.");
+  }
+
+  std::unordered_map<std::string, int> keywords, chars;
+  for (const std::string &symbol : candidates) {
+    if (symbol.length() > 1) keywords.emplace(symbol, 0);
+  }
+  count_frequencies_in_input(inputFile, keywords, chars);
+
+  std::unordered_map<std::string, int> freq;
+  for (const auto &[symbol, count] : chars) {
+    if (count > 0) freq[symbol] = count;
+  }
+  for (const auto &[symbol, count] : keywords) {
+    if (count == 0) continue;
+    freq[symbol] = count;
+    for (char byte : symbol) freq.emplace(std::string(1, byte), 1);
+  }
+
+  tree = HuffmanTree(std::move(freq), maxCodeLength);
+  matcher = TokenMatcher(tree.getSymbols());
+}
+
+/**
+ * @brief Builds the initial codes of the dynamic mode
+ *
+ * Every byte gets a code, so any input can be encoded. With a table, its
+ * symbols keep their weight relative to their code length, and the bytes
+ * it lacks the lowest one; without one, all bytes start equal. The codes
+ * are limited to DynamicModel::MAX_CODE_LENGTH bits.
+ *
+ * @param table Codes of the table, or an empty tree
+ * @param tree Receives the initial codes
+ * @param matcher Receives the token trie
+ */
+static void dynamicTable(const HuffmanTree &table, HuffmanTree &tree,
+                         TokenMatcher &matcher) {
+  std::unordered_map<std::string, int> freq;
+  const std::vector<std::string> &symbols = table.getSymbols();
+  for (size_t id = 0; id < symbols.size(); id++) {
+    const unsigned length = table.getCodes()[id].length;
+    freq[symbols[id]] = 1 << (DynamicModel::PRIOR_BITS -
+                              std::min(length, DynamicModel::PRIOR_BITS));
+  }
+  for (int byte = 0; byte < 256; byte++) {
+    freq.emplace(std::string(1, static_cast<char>(byte)), 1);
+  }
+
+  tree = HuffmanTree(std::move(freq), DynamicModel::MAX_CODE_LENGTH);
+  matcher = TokenMatcher(tree.getSymbols());
+}
+
+/**
+ * @brief Compresses one stream with codes rebuilt as it goes
+ *
+ * The tokens are the longest matches, as in the static mode. Each one is
+ * written with the current codes of the model, then counted. Mapped
+ * files are encoded in slices; other input is encoded as soon as it
+ * arrives, and whenever the input has nothing more to give the completed
+ * bytes are written and flushed, so a reader of the output lags behind by
+ * less than a byte plus the tokens that may still grow.
+ *
+ * @param tree Initial codes, written in the header
+ * @param matcher Trie compiled from the symbols of the tree
+ * @param interval Symbols between two rebuilds
+ * @param mapped Input file, if it could be mapped
+ * @param in Input stream, when it could not
+ * @param out Output stream
+ */
+static void encodeDynamic(const HuffmanTree &tree, const TokenMatcher &matcher,
+                          uint32_t interval, MappedFile &mapped, std::istream &in,
+                          std::ostream &out) {
+  JcbFormat::writeHeader(out, tree, JcbFormat::FLAG_DYNAMIC);
+  JcbFormat::writeRebuildInterval(out, interval);
+
+  DynamicModel model(tree, interval);
+  BitWriter writer;
+  size_t skipped = 0;
+  auto encode = [&](const char *data, size_t limit, size_t size) {
+    return greedyTokens(matcher, data, limit, size, skipped, [&](int symbol) {
+      const HuffmanCode &code = model.code(symbol);
+      writer.write(code.bits, code.length);
+      model.update(symbol);
+    });
+  };
+
+  if (mapped.isMapped()) {
+    const std::string_view input = mapped.view();
+    size_t pos = 0;
+    while (pos < input.size()) {
+      const size_t size = input.size() - pos;
+      pos += encode(input.data() + pos, std::min(size, INPUT_WINDOW_SIZE), size);
+      mapped.release(pos);
+
+      if (writer.buffer().size() >= OUTPUT_BUFFER_SIZE) writer.drainTo(out);
+    }
+  } else {
+    const size_t lookahead = std::max<size_t>(matcher.maxSymbolLength(), 1);
+    InputWindow window(in, INPUT_WINDOW_SIZE);
+    while (window.fillAvailable()) {
+      const size_t size = window.size();
+      if (window.atEnd() or size >= lookahead) {
+        const size_t limit = window.atEnd() ? size : size - (lookahead - 1);
+        window.consume(encode(window.data(), limit, size));
+      }
+
+      if (window.idle()) {
+        writer.flushBytes();
+        writer.drainTo(out);
+        out.flush();
+      } else if (writer.buffer().size() >= OUTPUT_BUFFER_SIZE) {
+        writer.drainTo(out);
       }
     }
+  }
+
+  const HuffmanCode &eof = model.code(tree.getEofSymbol());
+  writer.write(eof.bits, eof.length);
+  writer.alignToByte();
+  writer.drainTo(out);
+}
+
+/**
+ * @brief Flushes the compressed output and counts its bytes
+ *
+ * A pipe has no position, so the bytes written to one are not counted.
+ *
+ * @param out Output stream
+ * @throws std::runtime_error If the output could not be written
+ */
+static void finishOutput(std::ostream &out) {
+  {
+    Stats::PhaseTimer timer(Stats::IO);
+    out.flush();
+  }
+  if (not out) throw std::runtime_error("Error writing compressed output.");
+
+  if (Stats::ENABLED) {
+    const std::streampos written = out.tellp();
+    if (written > 0) Stats::local().written(static_cast<uint64_t>(written));
+  }
+}
+
+/**
+ * @struct EncodedBlock
+ * @brief Block encoded by a worker, waiting to be written
+ */
+struct EncodedBlock {
+  size_t rawSize;                     ///< Size the block decodes to
+  uint8_t table;                      ///< Id of the table it is encoded with
+  std::vector<unsigned char> payload; ///< Encoded bit stream(s)
+};
 
-    if (!matched_token.empty()) {
-      // If a token was found, encode the token
-      buffer += codeTable.at(matched_token);
-      pos += matched_token.length();
+/**
+ * @brief Compresses one file with codes already loaded
+ *
+ * Regular files are memory-mapped and encoded in place; stdin and pipes
+ * are read through a fixed-size window. The encoded bytes are written out
+ * in batches, so memory use does not depend on the file size. In block
+ * mode, at most two blocks per worker are in flight at a time.
+ *
+ * With several tables, each block is encoded with the one TableSelector
+ * estimates to be the smallest, and its frame records the table id.
+ *
+ * @param trees Huffman trees holding the codes, by table id
+ * @param matchers Tries compiled from the symbols of each tree
+ * @param inputFile Path to the input file to be compressed ("-" for stdin)
+ * @param outputFile Path to the compressed output file ("-" for stdout)
+ * @param options Threads, block layout and parse strategy
+ * @throws std::runtime_error If unable to open input/output files
+ */
+static void encodeFile(const std::vector<HuffmanTree> &trees,
+                       const std::vector<TokenMatcher> &matchers,
+                       const std::string &inputFile,
+                       const std::string &outputFile,
+                       const CompressOptions &options) {
+  Stats::PhaseTimer timer(Stats::ENCODE);
+  for (const HuffmanTree &table : trees) Stats::local().codes(table.getCodes());
+
+  // Opens input and output files; the input is mapped when possible
+  MappedFile mapped(inputFile);
+  std::ifstream inFile;
+  std::ofstream outFile;
+  std::istream &in = mapped.isMapped() ? inFile : StreamIO::openInput(inputFile, inFile);
+  std::ostream &out = StreamIO::openOutput(outputFile, outFile);
+  const std::string_view input = mapped.view();
+
+  std::vector<Parser> parsers;
+  for (size_t i = 0; i < trees.size(); i++) {
+    parsers.push_back({trees[i], matchers[i], options.optimalParse});
+  }
+  const HuffmanTree &tree = trees[0];
+  const Parser &parser = parsers[0];
+
+  if (options.rebuildInterval > 0) {
+    if (options.blockSize > 0 or options.indexInterval > 0 or trees.size() > 1 or
+        options.optimalParse) {
+      throw std::runtime_error("Dynamic codes need a single stream parsed greedily; "
+                               "they exclude blocks, --index, --tables and --best.");
+    }
+    encodeDynamic(tree, parser.matcher, options.rebuildInterval, mapped, in, out);
+    finishOutput(out);
+    return;
+  }
+
+  if (options.interleave and options.blockSize == 0) {
+    throw std::runtime_error("Interleaved streams are written per block; a block size is needed.");
+  }
+  if (trees.size() > 1 and options.blockSize == 0) {
+    throw std::runtime_error("Tables are chosen per block; a block size is needed.");
+  }
+
+  if (options.blockSize > 0) {
+    if (options.blockSize > JcbFormat::MAX_BLOCK_SIZE) {
+      throw std::runtime_error("Block size too large.");
+    }
+    if (options.indexInterval > 0) {
+      throw std::runtime_error("Block files are indexed by their frames; --index is for single-stream files.");
+    }
+
+    // Describes the codes for the decompressor
+    uint8_t flags = JcbFormat::FLAG_BLOCKS;
+    if (options.interleave) flags |= JcbFormat::FLAG_INTERLEAVED;
+    if (trees.size() > 1) flags |= JcbFormat::FLAG_TABLES;
+    JcbFormat::writeHeader(out, trees, flags);
+
+    // Blocks are encoded concurrently and written in input order
+    const TableSelector selector(trees);
+    ThreadPool pool(options.threads);
+    std::deque<std::future<EncodedBlock>> pending;
+
+    size_t offset = 0, written = 0;
+    auto writeOldest = [&] {
+      EncodedBlock encoded = pending.front().get();
+      {
+        Stats::PhaseTimer io(Stats::IO);
+        JcbFormat::writeBlock(out, flags, encoded.rawSize, encoded.payload, encoded.table);
+      }
+      pending.pop_front();
+
+      // Blocks finish in order, so the mapped input before them is done
+      written += options.blockSize;
+      mapped.release(written);
+    };
+
+    while (true) {
+      // Mapped blocks are views into the file, read blocks own their bytes
+      std::vector<char> block;
+      std::string_view view;
+      if (mapped.isMapped()) {
+        view = input.substr(offset, options.blockSize);
+        offset += view.size();
+      } else {
+        Stats::PhaseTimer io(Stats::IO);
+        block.resize(options.blockSize);
+        in.read(block.data(), static_cast<std::streamsize>(block.size()));
+        block.resize(static_cast<size_t>(in.gcount()));
+        if (in.bad()) throw std::runtime_error("Error reading input.");
+        view = std::string_view(block.data(), block.size());
+      }
+      if (view.empty()) break;
+
+      // Moving the vector into the task keeps its storage, so the view stays valid
+      if (pending.size() >= 2 * pool.size()) writeOldest();
+      pending.push_back(pool.submit([&parsers, &selector, &options, view, block = std::move(block)] {
+        const auto table = static_cast<uint8_t>(selector.select(view));
+        auto [rawSize, payload] = options.interleave ? encodeInterleavedBlock(parsers[table], view)
+                                                     : encodeBlock(parsers[table], view);
+        return EncodedBlock{rawSize, table, std::move(payload)};
+      }));
+    }
+    while (not pending.empty()) writeOldest();
+
+    JcbFormat::writeEnd(out);
+  } else {
+    // Describes the codes for the decompressor
+    const bool indexed = options.indexInterval > 0;
+    JcbFormat::writeHeader(out, tree, indexed ? JcbFormat::FLAG_INDEX : 0);
+
+    BitWriter writer;
+    size_t skipped = 0;
+
+    // With an index, encoding stops at the first token boundary after each
+    // interval to record where decoding can resume
+    std::vector<SyncPoint> index;
+    uint64_t encoded = 0;
+    uint64_t nextSync = options.indexInterval;
+    auto encode = [&](const char *data, size_t limit, size_t size) {
+      size_t pos = 0;
+      while (pos < limit) {
+        size_t stop = limit;
+        if (indexed) {
+          if (encoded + pos >= nextSync) {
+            index.push_back({writer.bitCount(), encoded + pos - skipped});
+            nextSync = encoded + pos + options.indexInterval;
+          }
+          stop = static_cast<size_t>(std::min<uint64_t>(limit, nextSync - encoded));
+        }
+        pos += encodeTokens(writer, parser, data + pos, stop - pos, size - pos, skipped);
+      }
+      encoded += pos;
+      return pos;
+    };
+
+    if (mapped.isMapped()) {
+      // The whole file is visible, so tokens are only cut into slices to
+      // write the encoded bytes out regularly
+      size_t pos = 0;
+      while (pos < input.size()) {
+        const size_t size = input.size() - pos;
+        const size_t limit = std::min(size, INPUT_WINDOW_SIZE);
+        pos += encode(input.data() + pos, limit, size);
+        mapped.release(pos);
+
+        if (writer.buffer().size() >= OUTPUT_BUFFER_SIZE) writer.drainTo(out);
+      }
     } else {
-      // If no token matches, encode a single character
-      std::string single_char(1, file_content[pos]);
-      if (codeTable.count(single_char)) {
-        buffer += codeTable.at(single_char);
+      const size_t lookahead = std::max<size_t>(parser.matcher.maxSymbolLength(), 1);
+      InputWindow window(in, INPUT_WINDOW_SIZE);
+      while (window.fill()) {
+        // A token may only start where the longest symbol still fits in the
+        // window; the rest waits for the next fill, unless the input ended
+        const size_t size = window.size();
+        const size_t limit = window.atEnd() ? size : size - (lookahead - 1);
+
+        window.consume(encode(window.data(), limit, size));
+
+        // Writes the completed bytes to the output file
+        if (writer.buffer().size() >= OUTPUT_BUFFER_SIZE) writer.drainTo(out);
       }
-      pos++;
     }
 
-    // Writes complete bytes to the output file
-    while (buffer.size() >= 8) {
-      std::bitset<8> bits(buffer.substr(0, 8));
-      buffer.erase(0, 8);
-      out.put(static_cast<unsigned char>(bits.to_ulong()));
+    // Encodes the end-of-file (EOF) symbol and pads the last byte with zeros
+    writeSymbol(writer, tree, tree.getEofSymbol());
+    writer.alignToByte();
+    writer.drainTo(out);
+
+    if (indexed) JcbFormat::writeIndex(out, index, encoded - skipped);
+  }
+
+  finishOutput(out);
+}
+
+/**
+ * @brief Compresses a file using Huffman encoding
+ *
+ * The function uses an external frequency table, or, in adaptive mode,
+ * counts the input first and builds the codes from it. The output file
+ * starts with a header holding the canonical code lengths, so it can be
+ * decompressed without the table.
+ *
+ * @param inputFile Path to the input file to be compressed ("-" for stdin)
+ * @param outputFile Path to the compressed output file ("-" for stdout)
+ * @param tablePath Path to the external frequency table; may be empty in
+ *        adaptive mode
+ * @param options Threads, block layout, parse strategy and code settings
+ * @throws std::runtime_error If unable to open input/output files
+ */
+void Compressor::compress(const std::string &inputFile,
+              const std::string &outputFile,
+              const std::string &tablePath,
+              const CompressOptions &options) {
+  std::vector<std::string> tablePaths;
+  if (not tablePath.empty()) tablePaths.push_back(tablePath);
+  compress(inputFile, outputFile, tablePaths, options);
+}
+
+/**
+ * @brief Compresses a file choosing, for each block, among several tables
+ *
+ * @param inputFile Path to the input file to be compressed ("-" for stdin)
+ * @param outputFile Path to the compressed output file ("-" for stdout)
+ * @param tablePaths Paths of the tables; more than one needs a block size
+ * @param options Threads, block layout, parse strategy and code settings
+ * @throws std::runtime_error If unable to open input/output files or to
+ *         use that many tables
+ */
+void Compressor::compress(const std::string &inputFile,
+                          const std::string &outputFile,
+                          const std::vector<std::string> &tablePaths,
+                          const CompressOptions &options) {
+  if (tablePaths.size() > JcbFormat::MAX_TABLES) {
+    throw std::runtime_error("Too many tables; at most " +
+                             std::to_string(JcbFormat::MAX_TABLES) + " are allowed.");
+  }
+  if (options.adaptive and tablePaths.size() > 1) {
+    throw std::runtime_error("Adaptive mode builds one table from the input; give at most one table.");
+  }
+  const bool dynamic = options.rebuildInterval > 0;
+  if (dynamic and options.adaptive) {
+    throw std::runtime_error("Adaptive mode counts the input first; dynamic codes count it as they go.");
+  }
+  if (not options.adaptive and not dynamic and tablePaths.empty()) {
+    throw std::runtime_error("No frequency table given.");
+  }
+
+  std::vector<HuffmanTree> trees(std::max<size_t>(tablePaths.size(), 1));
+  std::vector<TokenMatcher> matchers(trees.size());
+  if (dynamic and tablePaths.size() <= 1) {
+    HuffmanTree table;
+    if (not tablePaths.empty()) Codec::loadTable(tablePaths[0], 0, table, matchers[0]);
+    dynamicTable(table, trees[0], matchers[0]);
+  } else if (options.adaptive) {
+    if (not tablePaths.empty()) Codec::loadTable(tablePaths[0], 0, trees[0], matchers[0]);
+    const std::vector<std::string> candidates = trees[0].getSymbols();
+    adaptTable(inputFile, candidates, options.maxCodeLength, trees[0], matchers[0]);
+  } else {
+    for (size_t i = 0; i < tablePaths.size(); i++) {
+      Codec::loadTable(tablePaths[i], options.maxCodeLength, trees[i], matchers[i]);
     }
   }
+  encodeFile(trees, matchers, inputFile, outputFile, options);
+}
 
-  // Encodes the end-of-file (EOF) symbol
-  buffer += codeTable.at("EOF");
+/**
+ * @brief Compresses many files, each into a sibling .jcb file
+ *
+ * The table is loaded once and shared by the workers, which compress
+ * whole files concurrently, each writing its own output. In adaptive
+ * mode, each file gets codes counted from itself, the table proposing the
+ * multi-character symbols. A file that fails does not stop the others.
+ *
+ * @param inputFiles Paths of the files to be compressed
+ * @param tablePath Path to the external frequency table
+ * @param options Workers, parse strategy and code settings (the block
+ * layout is ignored)
+ * @return std::vector<BatchResult> Outcome of each file, in input order
+ * @throws std::runtime_error If unable to load the table
+ */
+std::vector<BatchResult> Compressor::compressBatch(const std::vector<std::string> &inputFiles,
+                                                   const std::string &tablePath,
+                                                   const CompressOptions &options) {
+  const bool dynamic = options.rebuildInterval > 0;
+  if (dynamic and options.adaptive) {
+    throw std::runtime_error("Adaptive mode counts the input first; dynamic codes count it as they go.");
+  }
+  if (not dynamic and tablePath.empty()) throw std::runtime_error("No frequency table given.");
 
-  // Processes remaining bits in the buffer
-  if (not buffer.empty()) {
-    buffer.resize(8, '0'); // Ensures the buffer has 8 bits
-    std::bitset<8> bits(buffer);
-    out.put(static_cast<unsigned char>(bits.to_ulong()));
+  std::vector<HuffmanTree> trees(1);
+  std::vector<TokenMatcher> matchers(1);
+  if (dynamic) {
+    HuffmanTree table;
+    if (not tablePath.empty()) Codec::loadTable(tablePath, 0, table, matchers[0]);
+    dynamicTable(table, trees[0], matchers[0]);
+  } else {
+    Codec::loadTable(tablePath, options.adaptive ? 0 : options.maxCodeLength, trees[0], matchers[0]);
   }
 
-  // Closes the output file
-  out.close();
+  ThreadPool pool(options.threads);
+  std::vector<std::future<void>> pending;
+  pending.reserve(inputFiles.size());
 
-  std::cout << "Compression completed. Output: " << outputFile << std::endl;
+  // Each file is a single stream; only the code settings carry over
+  CompressOptions fileOptions;
+  fileOptions.optimalParse = options.optimalParse;
+  fileOptions.maxCodeLength = options.maxCodeLength;
+  fileOptions.adaptive = options.adaptive;
+  fileOptions.rebuildInterval = options.rebuildInterval;
+
+  std::vector<BatchResult> results(inputFiles.size());
+  for (size_t i = 0; i < inputFiles.size(); i++) {
+    results[i].inputFile = inputFiles[i];
+    results[i].outputFile = inputFiles[i] + ".jcb";
+    pending.push_back(pool.submit([&trees, &matchers, &fileOptions, &result = results[i]] {
+      if (fileOptions.adaptive) {
+        std::vector<HuffmanTree> fileTrees(1);
+        std::vector<TokenMatcher> fileMatchers(1);
+        adaptTable(result.inputFile, trees[0].getSymbols(), fileOptions.maxCodeLength,
+                   fileTrees[0], fileMatchers[0]);
+        encodeFile(fileTrees, fileMatchers, result.inputFile, result.outputFile, fileOptions);
+        return;
+      }
+      encodeFile(trees, matchers, result.inputFile, result.outputFile, fileOptions);
+    }));
+  }
+
+  for (size_t i = 0; i < pending.size(); i++) {
+    try {
+      pending[i].get();
+    } catch (const std::exception &e) {
+      results[i].error = e.what();
+    }
+  }
+  return results;
+}
+
+/**
+ * @brief Compiles a text frequency table into a binary table
+ *
+ * @param tablePath Path to the text frequency table
+ * @param outputFile Path to the compiled table
+ * @param maxCodeLength Longest code allowed; 0 for no limit
+ * @throws std::runtime_error If unable to read the table or write the output
+ */
+void Compressor::compileTable(const std::string &tablePath,
+                              const std::string &outputFile,
+                              unsigned maxCodeLength) {
+  HuffmanTree tree(tablePath, maxCodeLength);
+  CompiledTable::write(outputFile, tree, TokenMatcher(tree.getSymbols()));
 }
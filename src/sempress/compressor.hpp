@@ -11,6 +11,47 @@
 #include <unordered_map>
 #include <vector>
 
+/**
+ * @struct CompressOptions
+ * @brief Settings of a compression run
+ */
+struct CompressOptions {
+  /// Worker threads; 0 uses one per hardware thread
+  unsigned threads = 1;
+
+  /// Size of the independent blocks; 0 writes a single bit stream
+  size_t blockSize = 0;
+  /// Input bytes between sync points of a single bit stream; 0 writes no index
+  size_t indexInterval = 0;
+  /// Splits each block into interleaved bit streams (needs a block size)
+  bool interleave = false;
+
+  /// Chooses the tokens with the fewest encoded bits instead of the longest
+  /// match at each position; slower, but the output is smaller
+  bool optimalParse = false;
+
+  /// Longest code built from a text table; 0 for no limit
+  unsigned maxCodeLength = 0;
+
+  /// Counts the input in a first pass and builds the codes from it; the
+  /// table, if any, only proposes the multi-character symbols
+  bool adaptive = false;
+
+  /// Symbols between two rebuilds of codes that follow the counts of the
+  /// data seen so far (single pass, no table needed); 0 keeps them fixed
+  unsigned rebuildInterval = 0;
+};
+
+/**
+ * @struct BatchResult
+ * @brief Outcome of compressing one file of a batch
+ */
+struct BatchResult {
+  std::string inputFile;  ///< File that was compressed
+  std::string outputFile; ///< Compressed file written next to it
+  std::string error;      ///< Empty on success, otherwise the failure
+};
+
 /**
  * @class Compressor
  * @brief Class responsible for file compression using Huffman encoding
@@ -24,16 +65,87 @@ public:
   /**
    * @brief Compresses a file using Huffman encoding
    *
-   * The function uses an external frequency table created previously.
-   * The resulting compressed file contains only the encoded data.
+   * The function uses an external frequency table created previously, or
+   * with options.adaptive, codes counted from the input in a first pass
+   * (the input must then be a file, read twice). The resulting compressed
+   * file holds a header with the code lengths, followed by the encoded data.
+   *
+   * With options.rebuildInterval, the codes start from the table (or from
+   * equal counts for every byte without one) and are rebuilt from the
+   * counts of the data every rebuildInterval symbols, in a single pass.
+   * Live input is encoded and written out as it arrives.
+   *
+   * With a block size, the input is split into independent blocks that
+   * are encoded concurrently by options.threads workers and written in
+   * order.
    *
    * @param inputFile Path to the input file to be compressed
    * @param outputFile Path to the compressed output file
-   * @param tablePath Path to the external frequency table file
+   * @param tablePath Path to the external frequency table file, in text
+   *        form or compiled by compileTable(); may be empty in adaptive and
+   *        dynamic modes
+   * @param options Threads, block layout, parse strategy and code settings
    *
    * @throws std::runtime_error If unable to open input/output files
    * @throws std::exception In case of error during file reading/writing
    */
   void compress(const std::string &inputFile, const std::string &outputFile,
-                const std::string &tablePath);
+                const std::string &tablePath,
+                const CompressOptions &options = CompressOptions());
+
+  /**
+   * @brief Compresses a file choosing, for each block, among several tables
+   *
+   * All the tables are stored in the header. Each block is encoded with
+   * the table estimated to give the smallest output, from its byte
+   * histogram and the code lengths of each table, and its frame records
+   * the table id, so the decompressor switches tables block by block.
+   *
+   * @param inputFile Path to the input file to be compressed
+   * @param outputFile Path to the compressed output file
+   * @param tablePaths Paths of the tables, text or compiled; more than one
+   *        needs options.blockSize (at most JcbFormat::MAX_TABLES)
+   * @param options Threads, block layout, parse strategy and code settings
+   *
+   * @throws std::runtime_error If unable to open input/output files or to
+   *         use that many tables
+   */
+  void compress(const std::string &inputFile, const std::string &outputFile,
+                const std::vector<std::string> &tablePaths,
+                const CompressOptions &options = CompressOptions());
+
+  /**
+   * @brief Compresses many files, each into a sibling .jcb file
+   *
+   * The table is loaded once, and options.threads workers compress whole
+   * files concurrently. In adaptive mode, each file gets its own codes.
+   * A file that fails does not stop the others.
+   *
+   * @param inputFiles Paths of the files to be compressed
+   * @param tablePath Path to the external frequency table file; may be
+   *        empty in dynamic mode
+   * @param options Workers, parse strategy and code settings (the
+   *        block layout is ignored)
+   * @return std::vector<BatchResult> Outcome of each file, in input order
+   *
+   * @throws std::runtime_error If unable to load the table
+   */
+  std::vector<BatchResult> compressBatch(const std::vector<std::string> &inputFiles,
+                                         const std::string &tablePath,
+                                         const CompressOptions &options = CompressOptions());
+
+  /**
+   * @brief Compiles a text frequency table into a binary table
+   *
+   * The binary table holds the canonical codes and the token trie, so
+   * compress() can load it without parsing the text or building the tree.
+   *
+   * @param tablePath Path to the text frequency table
+   * @param outputFile Path to the compiled table
+   * @param maxCodeLength Longest code allowed; 0 for no limit
+   *
+   * @throws std::runtime_error If unable to read the table or write the output
+   */
+  void compileTable(const std::string &tablePath, const std::string &outputFile,
+                    unsigned maxCodeLength = 0);
 };
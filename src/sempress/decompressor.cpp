@@ -1,71 +1,476 @@
-/**
- * @file decompressor.cpp
- * @brief Implementation of decompression functions using Huffman algorithm
- */
-#include "decompressor.hpp"
-#include "huffman_tree.hpp"
-#include <bitset>
-#include <vector>
-#include <algorithm>
-#include <sstream>
-#include <iterator>
-
-/**
- * @brief Decompresses a file using the Huffman tree
- *
- * This function reads a compressed file, uses an external Huffman table
- * to reconstruct the tree, and decodes the compressed data, writing the
- * result to an output file.
- *
- * @param inputFile Path to the compressed file to be decompressed
- * @param outputFile Path to the decompressed output file
- * @param tablePath Path to the Huffman table used for decompression
- * @throws std::runtime_error If unable to open input/output files
- */
-void Decompressor::decompress(const std::string &inputFile,
-        const std::string &outputFile,
-        const std::string &tablePath) {
-
-  // Creates the Huffman tree from the table file
-  HuffmanTree tree(tablePath);
-
-  // Opens the input and output files
-  std::ifstream in(inputFile, std::ios::binary);
-  std::ofstream out(outputFile);
-
-  if (not in.is_open() or not out.is_open())
-  throw std::runtime_error("Error opening files for decompression.");
-
-  // Reads the compressed file and converts it to a bit string
-  std::string binary_string;
-  char byte;
-  while (in.get(byte)) {
-    binary_string += std::bitset<8>(static_cast<unsigned char>(byte)).to_string();
-  }
-  in.close();
-
-  // Decodes the bit string using the Huffman tree
-  std::string decoded_string;
-  std::shared_ptr<HuffmanNode> current_node = tree.getRoot();
-  for (char bit : binary_string) {
-    if (bit == '0') {
-      current_node = current_node->left;
-    } else {
-      current_node = current_node->right;
-    }
-
-    // If we reach a leaf node, we found a symbol
-    if (current_node->isLeaf()) {
-      // Stop decompression if the EOF symbol is found
-      if (current_node->symbol == "EOF") {
-        break;
-      }
-      decoded_string += current_node->symbol;
-      current_node = tree.getRoot(); // Go back to the root for the next symbol
-    }
-  }
-
-  // Writes the decoded content to the output file
-  out << decoded_string;
-  out.close();
-}
\ No newline at end of file
+/**
+ * @file decompressor.cpp
+ * @brief Implementation of decompression functions using Huffman algorithm
+ */
+#include "decompressor.hpp"
+#include "byte_order.hpp"
+#include "dynamic_model.hpp"
+#include "huffman_decoder.hpp"
+#include "huffman_tree.hpp"
+#include "input_window.hpp"
+#include "jcb_format.hpp"
+#include "stats.hpp"
+#include "stream_io.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+/// Size of the chunks in which the compressed data is read
+static constexpr size_t INPUT_CHUNK_SIZE = 1 << 20;
+
+/// Size of the chunks in which the decoded data is written
+static constexpr size_t OUTPUT_CHUNK_SIZE = 1 << 20;
+
+/**
+ * @brief Decodes one independent block
+ *
+ * @param decoder Decoder built from the header of the file
+ * @param payload Bit stream of the block, or its interleaved streams
+ * @param rawSize Uncompressed size recorded in the block frame
+ * @param interleaved Whether the payload holds interleaved streams
+ * @return std::vector<char> Decoded bytes of the block
+ * @throws std::runtime_error If the block does not decode to rawSize bytes
+ */
+static std::vector<char> decodeBlock(const HuffmanDecoder &decoder,
+                                     const std::vector<unsigned char> &payload,
+                                     uint64_t rawSize, bool interleaved) {
+  // Every code takes a bit at least, so a frame announcing more bytes than
+  // its payload can hold is corrupted; checked before allocating for them
+  if (rawSize > 8 * static_cast<uint64_t>(payload.size()) * decoder.getMaxSymbolLength()) {
+    throw std::runtime_error("Corrupted compressed block.");
+  }
+  std::vector<char> decoded(rawSize + decoder.getSlack());
+  size_t size;
+  bool finished = false;
+
+  if (interleaved) {
+    // Token count and sizes of the first streams, then the streams
+    constexpr unsigned STREAMS = HuffmanDecoder::INTERLEAVE;
+    const size_t jumpSize = 4 * STREAMS;
+    if (payload.size() < jumpSize) throw std::runtime_error("Corrupted compressed block.");
+
+    uint64_t count = getUint32(payload.data());
+    size_t offsets[STREAMS + 1] = {jumpSize};
+    for (unsigned i = 0; i + 1 < STREAMS; i++) {
+      offsets[i + 1] = offsets[i] + getUint32(payload.data() + 4 * (i + 1));
+      if (offsets[i + 1] > payload.size()) throw std::runtime_error("Corrupted compressed block.");
+    }
+    offsets[STREAMS] = payload.size();
+
+    BitReader readers[STREAMS] = {
+        {payload.data() + offsets[0], offsets[1] - offsets[0]},
+        {payload.data() + offsets[1], offsets[2] - offsets[1]},
+        {payload.data() + offsets[2], offsets[3] - offsets[2]},
+        {payload.data() + offsets[3], offsets[4] - offsets[3]}};
+    size = decoder.decodeInterleaved(readers, count, decoded.data(), decoded.size());
+    finished = count == 0;
+  } else {
+    BitReader reader(payload.data(), payload.size());
+    HuffmanDecoder::Stop stop;
+    size = decoder.decodeInto(reader, decoded.data(), decoded.size(), stop);
+    finished = stop == HuffmanDecoder::END_OF_DATA;
+  }
+
+  if (not finished or size != rawSize) {
+    throw std::runtime_error("Corrupted compressed block.");
+  }
+  decoded.resize(size);
+  return decoded;
+}
+
+/**
+ * @brief Builds a decoder for each table of a header
+ *
+ * @param trees Trees read from the header, by table id
+ * @return std::vector<HuffmanDecoder> Decoders by table id
+ */
+static std::vector<HuffmanDecoder> buildDecoders(const std::vector<HuffmanTree> &trees) {
+  Stats::PhaseTimer timer(Stats::TREE_BUILD);
+  std::vector<HuffmanDecoder> decoders;
+  for (const HuffmanTree &tree : trees) decoders.emplace_back(tree);
+  return decoders;
+}
+
+/**
+ * @brief Returns the decoder of the table a block frame names
+ *
+ * @param decoders Decoders by table id
+ * @param table Table id read from the frame
+ * @return const HuffmanDecoder& Decoder of that table
+ * @throws std::runtime_error If the file has no such table
+ */
+static const HuffmanDecoder &tableDecoder(const std::vector<HuffmanDecoder> &decoders,
+                                          uint8_t table) {
+  if (table >= decoders.size()) throw std::runtime_error("Corrupted compressed block.");
+  return decoders[table];
+}
+
+/**
+ * @brief Decodes a single bit stream read from a stream
+ *
+ * The compressed data is read through a fixed-size window, and the decoded
+ * bytes are handed to the sink in chunks of fixed size, until the sink
+ * needs no more. A part of a stream, such as the bytes between two sync
+ * points, is decoded by starting in the middle of its first byte and
+ * limiting the bytes read; it need not reach the end-of-file symbol if the
+ * sink stops first.
+ *
+ * @param decoder Decoder built from the header of the file
+ * @param in Input stream, positioned at the byte holding the first bit
+ * @param sink Receives each chunk of decoded bytes; returns false once it
+ *        needs no more
+ * @param firstBit Bits of the first byte to skip
+ * @param limit Compressed bytes to read at most
+ * @throws std::runtime_error If the bit stream ends before its end-of-file
+ *         symbol while the sink needs more
+ */
+static void decodeStream(const HuffmanDecoder &decoder, std::istream &in,
+                         const std::function<bool(const char *, size_t)> &sink,
+                         unsigned firstBit = 0, uint64_t limit = UINT64_MAX) {
+  // While more input may come, a code is only decoded if the longest one
+  // fits in the loaded bits, so that no code is cut at the end of a chunk
+  const uint64_t margin = decoder.getMaxCodeLength();
+
+  InputWindow window(in, INPUT_CHUNK_SIZE, limit);
+  std::vector<char> decoded(OUTPUT_CHUNK_SIZE + decoder.getSlack());
+  HuffmanDecoder::Stop stop = HuffmanDecoder::MORE;
+  bool wanted = true;
+  unsigned skipBits = firstBit;
+
+  while (stop == HuffmanDecoder::MORE and wanted and window.fill()) {
+    const auto *data = reinterpret_cast<const unsigned char *>(window.data());
+    const uint64_t totalBits = 8 * static_cast<uint64_t>(window.size());
+
+    // Resumes in the middle of the first byte if the last chunk ended there
+    BitReader reader(data, window.size());
+    reader.consume(skipBits);
+    reader.refill();
+
+    const uint64_t reserve = window.atEnd() ? 0 : margin;
+    while (stop == HuffmanDecoder::MORE and wanted) {
+      size_t size = decoder.decodeInto(reader, decoded.data(), decoded.size(),
+                                       stop, reserve);
+      wanted = sink(decoded.data(), size);
+      if (reader.bitsLeft() < reserve) break;
+    }
+
+    // Keeps the byte holding the first unread bit for the next chunk
+    uint64_t consumed = totalBits - reader.bitsLeft();
+    window.consume(static_cast<size_t>(consumed / 8));
+    skipBits = static_cast<unsigned>(consumed % 8);
+  }
+
+  if (wanted and stop != HuffmanDecoder::END_OF_DATA) {
+    throw std::runtime_error("Truncated compressed data.");
+  }
+}
+
+/**
+ * @brief Decodes a bit stream whose codes are rebuilt as it goes
+ *
+ * The model starts from the codes of the header and counts each decoded
+ * symbol, as the encoder did, so both rebuild the same codes at the same
+ * points. The input is decoded as it arrives: every code whose bits are
+ * loaded is decoded at once, and only a code cut at the end of the loaded
+ * bits waits for more input.
+ *
+ * @param tree Initial codes, read from the header
+ * @param interval Symbols between two rebuilds
+ * @param in Input stream, positioned at the bit stream
+ * @param sink Receives each piece of decoded bytes; returns false once it
+ *        needs no more, which ends decoding there
+ * @throws std::runtime_error If the bit stream is corrupted or truncated
+ *         while the sink needs more
+ */
+static void decodeDynamic(const HuffmanTree &tree, uint32_t interval, std::istream &in,
+                          const std::function<bool(const char *, size_t)> &sink) {
+  DynamicModel model(tree, interval);
+  const std::vector<std::string> &symbols = tree.getSymbols();
+  const int eof = tree.getEofSymbol();
+
+  InputWindow window(in, INPUT_CHUNK_SIZE);
+  std::string decoded;
+  decoded.reserve(OUTPUT_CHUNK_SIZE);
+  bool finished = false;
+  unsigned skipBits = 0;
+
+  while (not finished and window.fillAvailable()) {
+    const auto *data = reinterpret_cast<const unsigned char *>(window.data());
+    const uint64_t totalBits = 8 * static_cast<uint64_t>(window.size());
+
+    // Resumes in the middle of the first byte if the last piece ended there
+    BitReader reader(data, window.size());
+    reader.consume(skipBits);
+    reader.refill();
+
+    while (reader.bitsLeft() > 0) {
+      // Codes are prefix-free, so a code that fits in the bits left is
+      // resolved whatever follows them; one that does not is cut
+      const int symbol = model.decode(reader);
+      if (symbol == DynamicModel::NO_SYMBOL) {
+        if (reader.bitsLeft() < model.getMaxCodeLength()) break;
+        throw std::runtime_error("Corrupted compressed data.");
+      }
+      if (symbol == eof) {
+        finished = true;
+        break;
+      }
+      decoded += symbols[symbol];
+      model.update(symbol);
+
+      if (decoded.size() >= OUTPUT_CHUNK_SIZE) {
+        if (not sink(decoded.data(), decoded.size())) return;
+        decoded.clear();
+      }
+    }
+    if (not decoded.empty() and not sink(decoded.data(), decoded.size())) return;
+    decoded.clear();
+
+    if (not finished and window.atEnd()) {
+      throw std::runtime_error("Truncated compressed data.");
+    }
+
+    // Keeps the byte holding the first unread bit for the next piece
+    const uint64_t consumed = totalBits - reader.bitsLeft();
+    window.consume(static_cast<size_t>(consumed / 8));
+    skipBits = static_cast<unsigned>(consumed % 8);
+  }
+}
+
+/**
+ * @brief Writes a piece of decoded bytes and counts them
+ *
+ * @param out Output stream
+ * @param data Decoded bytes
+ * @param size Number of bytes
+ */
+static void writeDecoded(std::ostream &out, const char *data, size_t size) {
+  Stats::PhaseTimer timer(Stats::IO);
+  out.write(data, static_cast<std::streamsize>(size));
+  Stats::local().written(size);
+}
+
+/**
+ * @brief Flushes the decompressed output and counts the compressed bytes
+ *
+ * Standard input has no position, so the bytes read from it are not
+ * counted.
+ *
+ * @param in Compressed input, read to its end
+ * @param out Output stream
+ * @throws std::runtime_error If the output could not be written
+ */
+static void finishOutput(std::istream &in, std::ostream &out) {
+  {
+    Stats::PhaseTimer timer(Stats::IO);
+    out.flush();
+  }
+  if (not out) throw std::runtime_error("Error writing decompressed output.");
+
+  if (Stats::ENABLED) {
+    in.clear();
+    const std::streampos read = in.tellg();
+    if (read > 0) Stats::local().read(static_cast<uint64_t>(read));
+  }
+}
+
+/**
+ * @brief Decompresses a file using the Huffman tree
+ *
+ * This function reads a compressed file, rebuilds the canonical codes from
+ * the code lengths stored in its header, and decodes the compressed data
+ * through the lookup tables of a HuffmanDecoder, writing the result to an
+ * output file.
+ *
+ * The compressed data is read and the decoded data is written in chunks of
+ * fixed size, so memory use does not depend on the file size. Block-framed
+ * files keep at most two blocks per worker in flight.
+ *
+ * @param inputFile Path to the compressed file ("-" for stdin)
+ * @param outputFile Path to the decompressed output file ("-" for stdout)
+ * @param options Threads used for block-framed files
+ * @throws std::runtime_error If unable to open input/output files or if
+ *         the input is not a compressed file
+ */
+void Decompressor::decompress(const std::string &inputFile,
+        const std::string &outputFile,
+        const DecompressOptions &options) {
+  Stats::PhaseTimer timer(Stats::DECODE);
+
+  // Opens the input and output files
+  std::ifstream inFile;
+  std::ofstream outFile;
+  std::istream &in = StreamIO::openInput(inputFile, inFile);
+  std::ostream &out = StreamIO::openOutput(outputFile, outFile);
+
+  // Rebuilds the codes from the header, no table file needed
+  uint8_t flags;
+  const std::vector<HuffmanTree> trees = JcbFormat::readTables(in, flags);
+  for (const HuffmanTree &tree : trees) Stats::local().codes(tree.getCodes());
+
+  if (flags & JcbFormat::FLAG_DYNAMIC) {
+    // Each piece is flushed, so a live stream is readable as it is decoded
+    const uint32_t interval = JcbFormat::readRebuildInterval(in);
+    decodeDynamic(trees[0], interval, in, [&out](const char *data, size_t size) {
+      writeDecoded(out, data, size);
+      out.flush();
+      return true;
+    });
+    finishOutput(in, out);
+    return;
+  }
+
+  const std::vector<HuffmanDecoder> decoders = buildDecoders(trees);
+  const HuffmanDecoder &decoder = decoders[0];
+
+  if (flags & JcbFormat::FLAG_BLOCKS) {
+    const bool interleaved = flags & JcbFormat::FLAG_INTERLEAVED;
+
+    // Blocks are decoded concurrently and written in file order
+    ThreadPool pool(options.threads);
+    std::deque<std::future<std::vector<char>>> pending;
+
+    auto writeOldest = [&] {
+      std::vector<char> decoded = pending.front().get();
+      writeDecoded(out, decoded.data(), decoded.size());
+      pending.pop_front();
+    };
+
+    uint64_t rawSize;
+    uint8_t table;
+    std::vector<unsigned char> payload;
+    auto readBlock = [&] {
+      Stats::PhaseTimer io(Stats::IO);
+      return JcbFormat::readBlock(in, flags, rawSize, payload, table);
+    };
+    while (readBlock()) {
+      const HuffmanDecoder &blockDecoder = tableDecoder(decoders, table);
+      if (pending.size() >= 2 * pool.size()) writeOldest();
+      pending.push_back(pool.submit([&blockDecoder, rawSize, interleaved, payload = std::move(payload)] {
+        return decodeBlock(blockDecoder, payload, rawSize, interleaved);
+      }));
+      payload = std::vector<unsigned char>();
+    }
+    while (not pending.empty()) writeOldest();
+
+    finishOutput(in, out);
+    return;
+  }
+
+  decodeStream(decoder, in, [&out](const char *data, size_t size) {
+    writeDecoded(out, data, size);
+    return true;
+  });
+
+  finishOutput(in, out);
+}
+
+/**
+ * @brief Decompresses a byte range of a file
+ *
+ * Indexed files are decoded from the last sync point before the range up
+ * to the first one after it, and block files from the first block that
+ * overlaps the range, the others being skipped by seeking over their
+ * frames. Files with neither are decoded from the start.
+ *
+ * @param inputFile Path to the compressed file (must be seekable)
+ * @param outputFile Path to the output file ("-" for stdout)
+ * @param start First decoded byte to write
+ * @param end Decoded byte after the last one to write
+ * @throws std::runtime_error If unable to open input/output files or if
+ *         the input is not a compressed file
+ */
+void Decompressor::decompressRange(const std::string &inputFile,
+                                   const std::string &outputFile,
+                                   uint64_t start, uint64_t end) {
+  Stats::PhaseTimer timer(Stats::DECODE);
+  if (StreamIO::isStandard(inputFile)) {
+    throw std::runtime_error("A byte range needs a seekable compressed file, not stdin.");
+  }
+
+  std::ifstream in;
+  std::ofstream outFile;
+  StreamIO::openInput(inputFile, in);
+  std::ostream &out = StreamIO::openOutput(outputFile, outFile);
+
+  uint8_t flags;
+  const std::vector<HuffmanTree> trees = JcbFormat::readTables(in, flags);
+  const uint32_t interval =
+      (flags & JcbFormat::FLAG_DYNAMIC) ? JcbFormat::readRebuildInterval(in) : 0;
+  const std::vector<HuffmanDecoder> decoders =
+      interval > 0 ? std::vector<HuffmanDecoder>() : buildDecoders(trees);
+
+  // Writes the part of a decoded piece that falls in the range, and tells
+  // whether the range goes on past it
+  uint64_t position = 0;
+  auto emit = [&](const char *data, size_t size) {
+    uint64_t from = std::max(start, position);
+    uint64_t to = std::min(end, position + size);
+    if (from < to) writeDecoded(out, data + (from - position), to - from);
+    position += size;
+    return position < end;
+  };
+
+  if (interval > 0) {
+    decodeDynamic(trees[0], interval, in, emit);
+  } else if (flags & JcbFormat::FLAG_BLOCKS) {
+    uint64_t rawSize, payloadSize;
+    uint8_t table;
+    std::vector<unsigned char> payload;
+    while (position < end and JcbFormat::readFrame(in, flags, rawSize, payloadSize, table)) {
+      if (position + rawSize <= start) {
+        in.seekg(static_cast<std::streamoff>(payloadSize), std::ios::cur);
+        position += rawSize;
+        continue;
+      }
+      payload.resize(payloadSize);
+      if (not in.read(reinterpret_cast<char *>(payload.data()),
+                      static_cast<std::streamsize>(payloadSize))) {
+        throw std::runtime_error("Truncated block frame.");
+      }
+      std::vector<char> decoded = decodeBlock(tableDecoder(decoders, table), payload,
+                                              rawSize, flags & JcbFormat::FLAG_INTERLEAVED);
+      emit(decoded.data(), decoded.size());
+    }
+  } else if (flags & JcbFormat::FLAG_INDEX) {
+    const uint64_t dataStart = static_cast<uint64_t>(in.tellg());
+    std::vector<SyncPoint> points;
+    uint64_t rawSize;
+    const uint64_t dataEnd = JcbFormat::readIndex(in, points, rawSize);
+    if (dataEnd < dataStart) throw std::runtime_error("Invalid sync-point index.");
+    end = std::min(end, rawSize);
+
+    if (start < end) {
+      // Last sync point at or before start, first one at or after end
+      points.insert(points.begin(), {0, 0});
+      auto after = std::upper_bound(points.begin(), points.end(), start,
+                                    [](uint64_t offset, const SyncPoint &point) { return offset < point.rawOffset; });
+      const SyncPoint from = *(after - 1);
+      auto until = std::lower_bound(points.begin(), points.end(), end,
+                                    [](const SyncPoint &point, uint64_t offset) { return point.rawOffset < offset; });
+      const uint64_t lastByte = until == points.end() ? dataEnd - dataStart : (until->bitOffset + 7) / 8;
+
+      // Reads only the compressed bytes between the two sync points, through
+      // the same fixed-size window as a whole stream
+      const uint64_t firstByte = from.bitOffset / 8;
+      if (lastByte < firstByte or lastByte > dataEnd - dataStart) {
+        throw std::runtime_error("Invalid sync-point index.");
+      }
+      in.clear();
+      in.seekg(static_cast<std::streamoff>(dataStart + firstByte));
+
+      position = from.rawOffset;
+      decodeStream(decoders[0], in, emit, static_cast<unsigned>(from.bitOffset % 8),
+                   lastByte - firstByte);
+      if (position < end) throw std::runtime_error("Corrupted compressed data.");
+    }
+  } else {
+    decodeStream(decoders[0], in, emit);
+  }
+
+  out.flush();
+  if (not out) throw std::runtime_error("Error writing decompressed output.");
+}
@@ -1,37 +1,72 @@
-/**
- * @file decompressor.hpp
- * @brief Definition of the Decompressor class for decompressing files using the Huffman algorithm
- */
-#pragma once
-#include <fstream>
-#include <iostream>
-#include <queue>
-#include <string>
-#include <unordered_map>
-#include <vector>
-
-/**
- * @class Decompressor
- * @brief Class responsible for decompressing files using Huffman coding
- *
- * This class implements the Huffman decompression algorithm, which uses a frequency table to decode
- * variable-length codes, where more frequent characters have shorter codes.
- */
-class Decompressor {
-public:
-  /**
-   * @brief Decompresses a file using Huffman coding
-   *
-   * This function uses an external frequency table previously created. The compressed file should
-   * contain only the encoded data.
-   *
-   * @param inputFile Path to the input file to be decompressed
-   * @param outputFile Path to the output decompressed file
-   * @param tablePath Path to the external frequency table file
-   *
-   * @throws std::runtime_error If unable to open input/output files
-   * @throws std::exception In case of errors during file reading/writing
-   */
-  void decompress(const std::string &inputFile, const std::string &outputFile,
-                  const std::string &tablePath);
-};
+/**
+ * @file decompressor.hpp
+ * @brief Definition of the Decompressor class for decompressing files using the Huffman algorithm
+ */
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @struct DecompressOptions
+ * @brief Settings of a decompression run
+ */
+struct DecompressOptions {
+  /// Worker threads for block-framed files; 0 uses one per hardware thread
+  unsigned threads = 1;
+};
+
+/**
+ * @class Decompressor
+ * @brief Class responsible for decompressing files using Huffman coding
+ *
+ * This class implements the Huffman decompression algorithm. The codes are
+ * canonical, so they are rebuilt from the code lengths stored in the header
+ * of the compressed file.
+ */
+class Decompressor {
+public:
+  /**
+   * @brief Decompresses a file using Huffman coding
+   *
+   * The compressed file must start with the header written by the
+   * Compressor; no frequency table is needed.
+   *
+   * Block-framed files are decoded concurrently by options.threads
+   * workers and written in order.
+   *
+   * @param inputFile Path to the input file to be decompressed
+   * @param outputFile Path to the output decompressed file
+   * @param options Threads used for block-framed files
+   *
+   * @throws std::runtime_error If unable to open input/output files or if
+   *         the input is not a compressed file
+   * @throws std::exception In case of errors during file reading/writing
+   */
+  void decompress(const std::string &inputFile, const std::string &outputFile,
+                  const DecompressOptions &options = DecompressOptions());
+
+  /**
+   * @brief Decompresses a byte range of a file
+   *
+   * Files written with a sync-point index (--index) are decoded from the
+   * sync point before the range only, and block files from the blocks that
+   * overlap it, so the cost depends on the size of the range rather than
+   * on its position. Other files are decoded from the start.
+   *
+   * @param inputFile Path to the compressed file (must be seekable)
+   * @param outputFile Path to the output file
+   * @param start First decoded byte to write
+   * @param end Decoded byte after the last one to write (past the end of
+   *        the data means up to the end)
+   *
+   * @throws std::runtime_error If unable to open input/output files or if
+   *         the input is not a compressed file
+   */
+  void decompressRange(const std::string &inputFile, const std::string &outputFile,
+                       uint64_t start, uint64_t end);
+};
@@ -0,0 +1,163 @@
+/**
+ * @file dynamic_model.cpp
+ * @brief Implementation of the adaptive code model
+ */
+#include "dynamic_model.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+DynamicModel::DynamicModel(const HuffmanTree &initial, uint32_t interval)
+    : interval(std::max<uint32_t>(interval, 1)) {
+  const std::vector<HuffmanCode> &initialCodes = initial.getCodes();
+  const size_t n = initialCodes.size();
+
+  counts.resize(n);
+  order.resize(n);
+  sorted.resize(n);
+  work.resize(2 * n);
+  parent.resize(2 * n);
+  depths.resize(n);
+  lengths.resize(n);
+  codes.resize(n);
+  canonical.resize(n);
+  lookup.resize(size_t{1} << LOOKUP_BITS);
+
+  for (size_t id = 0; id < n; id++) {
+    const unsigned length = initialCodes[id].length;
+    if (length > MAX_CODE_LENGTH) {
+      throw std::runtime_error("Code too long for the dynamic mode.");
+    }
+    lengths[id] = length;
+    counts[id] = uint64_t{1} << (PRIOR_BITS - std::min(length, PRIOR_BITS));
+    total += counts[id];
+  }
+
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return counts[a] != counts[b] ? counts[a] < counts[b] : a < b;
+  });
+  assignCodes();
+}
+
+/**
+ * @brief Decodes the next symbol with the current codes
+ *
+ * Short codes are resolved by the lookup table. For longer ones, canonical
+ * codes of one length are consecutive and a prefix of a longer code is
+ * above every code of that length, so the first length whose range holds
+ * the leading bits gives the symbol.
+ *
+ * @param reader Bit reader positioned at a code
+ * @return int Symbol id, or NO_SYMBOL if the bits are not a code
+ */
+int DynamicModel::decode(BitReader &reader) const {
+  if (reader.available() < maxLength) reader.refill();
+  const uint32_t entry = lookup[reader.peek(LOOKUP_BITS)];
+  if (entry != 0) {
+    const unsigned length = entry & 0xFF;
+    if (length > reader.available()) return NO_SYMBOL;
+    reader.consume(length);
+    return static_cast<int>(entry >> 8);
+  }
+
+  const uint64_t bits = reader.peek(maxLength);
+  for (unsigned length = LOOKUP_BITS + 1; length <= maxLength; length++) {
+    const uint64_t offset = (bits >> (maxLength - length)) - firstCode[length];
+    if (offset < lengthCount[length]) {
+      if (length > reader.available()) return NO_SYMBOL;
+      reader.consume(length);
+      return static_cast<int>(canonical[firstIndex[length] + offset]);
+    }
+  }
+  return NO_SYMBOL;
+}
+
+/**
+ * @brief Computes the code lengths from the counts and assigns the codes
+ *
+ * Counts are halved (rounding up, so none drops to zero) when they grow
+ * past AGE_LIMIT, and again whenever a code would be longer than
+ * MAX_CODE_LENGTH.
+ */
+void DynamicModel::rebuild() {
+  pending = 0;
+  const size_t n = counts.size();
+
+  auto halve = [&] {
+    total = 0;
+    for (uint64_t &count : counts) {
+      count = (count + 1) / 2;
+      total += count;
+    }
+  };
+  if (total > AGE_LIMIT) halve();
+
+  while (true) {
+    // Only the symbols seen since the last rebuild moved, so the order is
+    // repaired by an insertion sort in about linear time
+    for (size_t i = 1; i < n; i++) {
+      const uint32_t id = order[i];
+      size_t j = i;
+      while (j > 0 and (counts[order[j - 1]] > counts[id] or
+                        (counts[order[j - 1]] == counts[id] and order[j - 1] > id))) {
+        order[j] = order[j - 1];
+        j--;
+      }
+      order[j] = id;
+    }
+
+    for (size_t i = 0; i < n; i++) sorted[i] = counts[order[i]];
+    HuffmanTree::lengthsFromSortedWeights(sorted.data(), n, work.data(),
+                                          parent.data(), depths.data());
+    if (*std::max_element(depths.begin(), depths.end()) <= MAX_CODE_LENGTH) break;
+    halve();
+  }
+
+  for (size_t i = 0; i < n; i++) lengths[order[i]] = depths[i];
+  assignCodes();
+}
+
+/**
+ * @brief Assigns canonical codes from the current lengths
+ *
+ * Symbols are ordered by (length, id) with a counting sort on the
+ * lengths, and each length starts at the previous code plus one, shifted
+ * left to the new length. Every LOOKUP_BITS-bit prefix of a short code
+ * maps to its symbol in the lookup table.
+ */
+void DynamicModel::assignCodes() {
+  lengthCount.fill(0);
+  for (unsigned length : lengths) lengthCount[length]++;
+
+  uint64_t code = 0;
+  uint32_t index = 0;
+  maxLength = 1;
+  for (unsigned length = 1; length <= MAX_CODE_LENGTH; length++) {
+    code = (code + lengthCount[length - 1]) << 1;
+    firstCode[length] = code;
+    firstIndex[length] = index;
+    index += lengthCount[length];
+    if (lengthCount[length] > 0) maxLength = length;
+  }
+
+  std::array<uint32_t, MAX_CODE_LENGTH + 1> next = firstIndex;
+  for (size_t id = 0; id < lengths.size(); id++) {
+    const unsigned length = lengths[id];
+    const uint32_t position = next[length]++;
+    canonical[position] = static_cast<uint32_t>(id);
+    codes[id].bits = firstCode[length] + (position - firstIndex[length]);
+    codes[id].length = static_cast<uint16_t>(length);
+  }
+
+  std::fill(lookup.begin(), lookup.end(), 0);
+  for (unsigned length = 1; length <= std::min(LOOKUP_BITS, maxLength); length++) {
+    const unsigned spread = LOOKUP_BITS - length;
+    for (uint32_t i = 0; i < lengthCount[length]; i++) {
+      const uint32_t id = canonical[firstIndex[length] + i];
+      const uint64_t first = (firstCode[length] + i) << spread;
+      std::fill_n(lookup.begin() + static_cast<std::ptrdiff_t>(first), size_t{1} << spread,
+                  id << 8 | length);
+    }
+  }
+}
@@ -0,0 +1,117 @@
+/**
+ * @file dynamic_model.hpp
+ * @brief Definition of the DynamicModel class, which adapts the codes of a
+ * stream to the symbols seen so far
+ */
+#pragma once
+#include "bit_reader.hpp"
+#include "huffman_tree.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class DynamicModel
+ * @brief Symbol counts and canonical codes rebuilt every few symbols
+ *
+ * The encoder and the decoder each keep a model, start from the code
+ * lengths of the header and update it with every symbol, so both always
+ * hold the same codes without any table being sent again. Every interval
+ * symbols the code lengths are computed again from the counts.
+ *
+ * A rebuild allocates nothing: the symbols stay sorted by count in a
+ * permutation that an insertion sort repairs (counts change little
+ * between rebuilds), the two-queue Huffman construction runs in arrays
+ * allocated once, and the canonical codes are assigned by a counting sort
+ * on the lengths, which also refills a small lookup table for the decoder.
+ * Counts are halved once their total exceeds AGE_LIMIT,
+ * so the codes follow changes in the data and stay short.
+ */
+class DynamicModel {
+public:
+  static constexpr unsigned MAX_CODE_LENGTH = 32;   ///< Longest code allowed
+  static constexpr unsigned PRIOR_BITS = 12;        ///< Scale of the initial counts
+  static constexpr uint64_t AGE_LIMIT = 1 << 20;    ///< Total count that halves them
+  static constexpr int NO_SYMBOL = -1;              ///< Invalid code
+  static constexpr unsigned LOOKUP_BITS = 10;       ///< Bits resolved by one lookup
+
+  /**
+   * @brief Creates a model starting from the codes of a header
+   *
+   * The initial count of a symbol with a code of length l is
+   * 2^(PRIOR_BITS - l), at least 1, so a trained table keeps some weight
+   * until the data outweighs it.
+   *
+   * @param initial Symbols and initial code lengths (ids are kept)
+   * @param interval Symbols between two rebuilds (at least 1)
+   * @throws std::runtime_error If a code is longer than MAX_CODE_LENGTH
+   */
+  DynamicModel(const HuffmanTree &initial, uint32_t interval);
+
+  /**
+   * @brief Returns the current code of a symbol
+   *
+   * @param symbol Symbol id
+   * @return const HuffmanCode& Packed code
+   */
+  const HuffmanCode &code(int symbol) const { return codes[symbol]; }
+
+  /**
+   * @brief Returns the length of the longest current code
+   *
+   * @return unsigned Number of bits a decoder must hold to decode any code
+   */
+  unsigned getMaxCodeLength() const { return maxLength; }
+
+  /**
+   * @brief Decodes the next symbol with the current codes
+   *
+   * @param reader Bit reader positioned at a code
+   * @return int Symbol id, or NO_SYMBOL if the bits are not a code
+   */
+  int decode(BitReader &reader) const;
+
+  /**
+   * @brief Counts a symbol, rebuilding the codes at the end of an interval
+   *
+   * Must be called with every symbol coded, in order, on both sides.
+   *
+   * @param symbol Symbol id just encoded or decoded
+   */
+  void update(int symbol) {
+    counts[symbol]++;
+    total++;
+    if (++pending == interval) rebuild();
+  }
+
+private:
+  uint32_t interval;     ///< Symbols between two rebuilds
+  uint32_t pending = 0;  ///< Symbols since the last rebuild
+  uint64_t total = 0;    ///< Sum of the counts
+
+  std::vector<uint64_t> counts;   ///< Count of each symbol
+  std::vector<uint32_t> order;    ///< Symbol ids by (count, id)
+  std::vector<uint64_t> sorted;   ///< Counts in the order of order
+  std::vector<uint64_t> work;     ///< Scratch weights of the tree
+  std::vector<uint32_t> parent;   ///< Scratch parents of the tree
+  std::vector<unsigned> depths;   ///< Code lengths in the order of order
+  std::vector<unsigned> lengths;  ///< Code length of each symbol
+  std::vector<HuffmanCode> codes; ///< Code of each symbol
+
+  std::vector<uint32_t> canonical; ///< Symbol ids by (length, id)
+  std::vector<uint32_t> lookup;    ///< Symbol id << 8 | length by first LOOKUP_BITS bits (0: longer code)
+  std::array<uint32_t, MAX_CODE_LENGTH + 1> lengthCount{}; ///< Codes of each length
+  std::array<uint32_t, MAX_CODE_LENGTH + 1> firstIndex{};  ///< First of each length in canonical
+  std::array<uint64_t, MAX_CODE_LENGTH + 1> firstCode{};   ///< First code of each length
+  unsigned maxLength = 1; ///< Longest code
+
+  /**
+   * @brief Computes the code lengths from the counts and assigns the codes
+   */
+  void rebuild();
+
+  /**
+   * @brief Assigns canonical codes from the current lengths
+   */
+  void assignCodes();
+};
@@ -0,0 +1,212 @@
+/**
+ * @file huffman_decoder.cpp
+ * @brief Implementation of the multi-level lookup table decoder
+ */
+#include "huffman_decoder.hpp"
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+/**
+ * @brief Builds the lookup tables from the codes of a tree
+ *
+ * @param tree Huffman tree whose codes will be decoded
+ *
+ * @note A tree with a single symbol has an empty code; it is given the
+ *       one-bit code "0" so the tables stay well-formed
+ */
+HuffmanDecoder::HuffmanDecoder(const HuffmanTree &tree)
+    : symbols(tree.getSymbols()) {
+  std::vector<PendingCode> codes;
+  for (size_t id = 0; id < symbols.size(); id++) {
+    std::string bits = tree.getCodeString(static_cast<int>(id));
+    if (bits.empty()) bits = "0";
+    codes.push_back({static_cast<int>(id), bits});
+    maxCodeLength = std::max(maxCodeLength, static_cast<unsigned>(bits.length()));
+  }
+  eofSymbol = tree.getEofSymbol();
+
+  // Pads every symbol to a multiple of 16 bytes for the chunked copies
+  for (const auto &symbol : symbols) {
+    slotSize = std::max(slotSize, (symbol.length() + 15) / 16 * 16);
+    maxSymbolLength = std::max(maxSymbolLength, symbol.length());
+  }
+  slots.assign(symbols.size() * slotSize, '\0');
+  for (size_t id = 0; id < symbols.size(); id++) {
+    std::memcpy(slots.data() + id * slotSize, symbols[id].data(), symbols[id].length());
+    lengths.push_back(static_cast<uint32_t>(symbols[id].length()));
+  }
+
+  rootBits = tableBits(codes);
+  entries.resize(size_t(1) << rootBits);
+  buildTable(codes, 0, rootBits);
+}
+
+unsigned HuffmanDecoder::tableBits(const std::vector<PendingCode> &codes) {
+  size_t longest = 1;
+  for (const auto &code : codes) longest = std::max(longest, code.bits.length());
+  return static_cast<unsigned>(std::min<size_t>(longest, PRIMARY_BITS));
+}
+
+/**
+ * @brief Builds one table for a set of codes sharing a prefix
+ *
+ * A code that fits in the table fills every entry whose index starts with
+ * it. Longer codes are grouped by their first bits, and each group gets a
+ * subtable, appended to entries, for the rest of its bits.
+ *
+ * @param codes Codes with the shared prefix already removed
+ * @param offset Position of the table in entries
+ * @param bits Index bits of the table
+ */
+void HuffmanDecoder::buildTable(const std::vector<PendingCode> &codes,
+                                size_t offset, unsigned bits) {
+  std::map<size_t, std::vector<PendingCode>> groups;
+
+  for (const auto &code : codes) {
+    size_t prefix = 0;
+    size_t used = std::min<size_t>(code.bits.length(), bits);
+    for (size_t i = 0; i < used; i++) prefix = (prefix << 1) | (code.bits[i] == '1');
+
+    if (code.bits.length() <= bits) {
+      // Every index starting with the code resolves to its symbol
+      size_t free = bits - used;
+      for (size_t fill = 0; fill < (size_t(1) << free); fill++) {
+        Entry &entry = entries[offset + ((prefix << free) | fill)];
+        entry.value = code.symbol;
+        entry.bits = static_cast<uint8_t>(used);
+        entry.kind = SYMBOL;
+      }
+    } else {
+      groups[prefix].push_back({code.symbol, code.bits.substr(bits)});
+    }
+  }
+
+  for (const auto &[prefix, group] : groups) {
+    unsigned subBits = tableBits(group);
+    size_t subOffset = entries.size();
+    entries.resize(subOffset + (size_t(1) << subBits));
+
+    Entry &link = entries[offset + prefix];
+    link.value = static_cast<int32_t>(subOffset);
+    link.bits = static_cast<uint8_t>(subBits);
+    link.kind = LINK;
+
+    buildTable(group, subOffset, subBits);
+  }
+}
+
+int HuffmanDecoder::decodeSlow(BitReader &reader, Entry entry) const {
+  unsigned bits = rootBits;
+  while (entry.kind == LINK) {
+    if (reader.available() < bits) return NO_SYMBOL;
+    reader.consume(bits);
+    if (reader.available() < PRIMARY_BITS) reader.refill();
+    const Entry *table = entries.data() + entry.value;
+    bits = entry.bits;
+    entry = table[reader.peek(bits)];
+  }
+
+  if (entry.kind != SYMBOL or reader.available() < entry.bits) {
+    return NO_SYMBOL;
+  }
+  reader.consume(entry.bits);
+  return entry.value;
+}
+
+/**
+ * @brief Decodes symbols straight into a byte buffer
+ *
+ * @param reader Bit reader positioned at the start of a code
+ * @param out Destination buffer
+ * @param capacity Size of the destination buffer in bytes
+ * @param stop Receives why decoding stopped
+ * @param reserveBits Bits the reader must hold to decode another symbol
+ * @return size_t Number of decoded bytes written to out
+ */
+size_t HuffmanDecoder::decodeInto(BitReader &reader, char *out,
+                                  size_t capacity, Stop &stop,
+                                  uint64_t reserveBits) const {
+  stop = MORE;
+  size_t written = 0;
+
+  while (written + slotSize <= capacity and reader.bitsLeft() >= reserveBits) {
+    int symbol = decode(reader);
+    if (symbol == NO_SYMBOL) {
+      stop = END_OF_BITS;
+      break;
+    }
+    if (symbol == eofSymbol) {
+      stop = END_OF_DATA;
+      break;
+    }
+
+    const char *slot = slots.data() + static_cast<size_t>(symbol) * slotSize;
+    uint32_t length = lengths[symbol];
+    for (size_t i = 0; i < length; i += 16) {
+      std::memcpy(out + written + i, slot + i, 16);
+    }
+    written += length;
+  }
+
+  return written;
+}
+
+/**
+ * @brief Decodes symbols spread round-robin over interleaved streams
+ *
+ * @param readers One bit reader per stream
+ * @param count Number of symbols to decode; receives the number left
+ * @param out Destination buffer
+ * @param capacity Size of the destination buffer in bytes
+ * @return size_t Number of decoded bytes written to out
+ */
+size_t HuffmanDecoder::decodeInterleaved(BitReader (&readers)[INTERLEAVE],
+                                         uint64_t &count, char *out,
+                                         size_t capacity) const {
+  size_t written = 0;
+  auto copy = [&](int symbol) {
+    const char *slot = slots.data() + static_cast<size_t>(symbol) * slotSize;
+    uint32_t length = lengths[symbol];
+    for (size_t i = 0; i < length; i += 16) {
+      std::memcpy(out + written + i, slot + i, 16);
+    }
+    written += length;
+  };
+  auto valid = [&](int symbol) { return symbol != NO_SYMBOL and symbol != eofSymbol; };
+
+  // One symbol of each stream per step, decoded before any is copied. The
+  // readers are copied to locals so their registers are not reloaded from
+  // memory between the lookups
+  BitReader r0 = readers[0], r1 = readers[1], r2 = readers[2], r3 = readers[3];
+  bool ended = false;
+  while (count >= INTERLEAVE and written + INTERLEAVE * slotSize <= capacity) {
+    int s0 = decode(r0);
+    int s1 = decode(r1);
+    int s2 = decode(r2);
+    int s3 = decode(r3);
+    if (not (valid(s0) and valid(s1) and valid(s2) and valid(s3))) {
+      ended = true;
+      break;
+    }
+    copy(s0);
+    copy(s1);
+    copy(s2);
+    copy(s3);
+    count -= INTERLEAVE;
+  }
+  readers[0] = r0;
+  readers[1] = r1;
+  readers[2] = r2;
+  readers[3] = r3;
+  if (ended) return written;
+
+  // The last symbols, or the ones near the end of the buffer
+  for (unsigned next = 0; count > 0 and written + slotSize <= capacity; next = (next + 1) % INTERLEAVE) {
+    int symbol = decode(readers[next]);
+    if (not valid(symbol)) return written;
+    copy(symbol);
+    count--;
+  }
+  return written;
+}
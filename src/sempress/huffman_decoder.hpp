@@ -0,0 +1,195 @@
+/**
+ * @file huffman_decoder.hpp
+ * @brief Definition of the HuffmanDecoder class, a multi-level lookup
+ * table decoder for the codes of a HuffmanTree
+ */
+#pragma once
+#include "bit_reader.hpp"
+#include "huffman_tree.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class HuffmanDecoder
+ * @brief Decodes symbols by peeking several bits at a time
+ *
+ * The primary table is indexed by the next PRIMARY_BITS bits of the
+ * stream and resolves every code up to that length in a single probe,
+ * returning the symbol and the number of bits to consume. Longer codes
+ * land on a link entry that points to a secondary table indexed by the
+ * following bits, and so on, so codes of any length are supported.
+ */
+class HuffmanDecoder {
+public:
+  static constexpr unsigned PRIMARY_BITS = 11; ///< Bits of the root table
+  static constexpr int NO_SYMBOL = -1; ///< Returned when the stream ends
+  static constexpr unsigned INTERLEAVE = 4; ///< Streams of interleaved blocks
+
+  /// Why decodeInto() returned
+  enum Stop {
+    MORE,        ///< The buffer or the loaded bits may not hold another symbol
+    END_OF_DATA, ///< The end-of-file symbol was read
+    END_OF_BITS  ///< The stream ended before a complete code
+  };
+
+  /**
+   * @brief Builds the lookup tables from the codes of a tree
+   *
+   * @param tree Huffman tree whose codes will be decoded
+   */
+  explicit HuffmanDecoder(const HuffmanTree &tree);
+
+  /**
+   * @brief Decodes the next symbol of the stream
+   *
+   * Codes resolved by the root table are decoded inline; longer codes and
+   * the end of the stream go through decodeSlow(), so the common case
+   * stays small enough to be inlined in the decoding loops.
+   *
+   * @param reader Bit reader positioned at the start of a code
+   * @return int Symbol id, or NO_SYMBOL if the stream ends before a
+   *         complete code
+   */
+  int decode(BitReader &reader) const {
+    if (reader.available() < PRIMARY_BITS) reader.refill();
+    Entry entry = entries[reader.peek(rootBits)];
+
+    if (entry.kind == SYMBOL and reader.available() >= entry.bits) {
+      reader.consume(entry.bits);
+      return entry.value;
+    }
+    return decodeSlow(reader, entry);
+  }
+
+  /**
+   * @brief Decodes symbols straight into a byte buffer
+   *
+   * Symbols are copied in fixed 16-byte chunks from a padded symbol array,
+   * so the buffer must have getSlack() bytes of room past the decoded data.
+   * Decoding stops at the end-of-file symbol, at the end of the stream, when
+   * another symbol might not fit, or when fewer than reserveBits bits are
+   * left in the reader. A stream that ends without its end-of-file symbol
+   * is told apart from one that is complete, so that truncated data is
+   * never taken for the whole of it.
+   *
+   * @param reader Bit reader positioned at the start of a code
+   * @param out Destination buffer
+   * @param capacity Size of the destination buffer in bytes
+   * @param stop Receives why decoding stopped
+   * @param reserveBits Bits the reader must hold to decode another symbol;
+   *        a caller streaming the input passes getMaxCodeLength() so that
+   *        no code is cut at the end of a chunk
+   * @return size_t Number of decoded bytes written to out
+   */
+  size_t decodeInto(BitReader &reader, char *out, size_t capacity,
+                    Stop &stop, uint64_t reserveBits = 0) const;
+
+  /**
+   * @brief Decodes symbols spread round-robin over interleaved streams
+   *
+   * Symbol i is read from readers[i % INTERLEAVE]. The main loop decodes
+   * one symbol of every stream per step; the lookups are independent, so
+   * the processor overlaps them instead of waiting on a single chain. As
+   * with decodeInto, out needs getSlack() bytes of room past the data.
+   * A block is decoded in a single call, starting with stream 0.
+   *
+   * @param readers One bit reader per stream
+   * @param count Number of symbols to decode; receives the number left
+   *        undecoded, nonzero if a stream ended early or the buffer is full
+   * @param out Destination buffer
+   * @param capacity Size of the destination buffer in bytes
+   * @return size_t Number of decoded bytes written to out
+   */
+  size_t decodeInterleaved(BitReader (&readers)[INTERLEAVE], uint64_t &count,
+                           char *out, size_t capacity) const;
+
+  /**
+   * @brief Returns the length of the longest code
+   *
+   * @return unsigned Length in bits
+   */
+  unsigned getMaxCodeLength() const { return maxCodeLength; }
+
+  /**
+   * @brief Returns the length of the longest symbol
+   *
+   * @return size_t Length in bytes
+   */
+  size_t getMaxSymbolLength() const { return maxSymbolLength; }
+
+  /**
+   * @brief Returns the room decodeInto needs past the decoded data
+   *
+   * @return size_t Size of the largest padded symbol, in bytes
+   */
+  size_t getSlack() const { return slotSize; }
+
+  /**
+   * @brief Returns the symbols indexed by symbol id
+   *
+   * @return const std::vector<std::string>& Symbols of the tree
+   */
+  const std::vector<std::string> &getSymbols() const { return symbols; }
+
+  /**
+   * @brief Returns the id of the end-of-file symbol
+   *
+   * @return int Symbol id
+   */
+  int getEofSymbol() const { return eofSymbol; }
+
+private:
+  enum Kind : uint8_t { INVALID, SYMBOL, LINK };
+
+  /// Table entry: a symbol and its remaining length, or a link to a subtable
+  struct Entry {
+    int32_t value = 0;    ///< Symbol id, or offset of the linked subtable
+    uint8_t bits = 0;     ///< Bits consumed by a symbol, or index bits of a link
+    Kind kind = INVALID;  ///< Kind of the entry
+  };
+
+  /// Code being placed in the tables: symbol id and the bits still unread
+  struct PendingCode {
+    int symbol;
+    std::string bits;
+  };
+
+  std::vector<Entry> entries;       ///< All tables, the root one first
+  std::vector<std::string> symbols; ///< Symbols indexed by symbol id
+  std::vector<char> slots;          ///< Symbols padded to slotSize bytes
+  std::vector<uint32_t> lengths;    ///< Length of each symbol
+  size_t slotSize = 16;             ///< Padded symbol size, multiple of 16
+  size_t maxSymbolLength = 0;       ///< Length of the longest symbol
+  unsigned rootBits = 1;            ///< Index bits of the root table
+  unsigned maxCodeLength = 1;       ///< Length of the longest code
+  int eofSymbol = NO_SYMBOL;        ///< Id of the end-of-file symbol
+
+  /**
+   * @brief Follows the links of a code longer than the root table
+   *
+   * @param reader Bit reader positioned at the start of the code
+   * @param entry Root table entry of the code
+   * @return int Symbol id, or NO_SYMBOL if the stream ends before a
+   *         complete code
+   */
+  int decodeSlow(BitReader &reader, Entry entry) const;
+
+  /**
+   * @brief Builds one table for a set of codes sharing a prefix
+   *
+   * @param codes Codes with the shared prefix already removed
+   * @param offset Position of the table in entries
+   * @param bits Index bits of the table
+   */
+  void buildTable(const std::vector<PendingCode> &codes, size_t offset,
+                  unsigned bits);
+
+  /**
+   * @brief Chooses the index bits of a table for a set of codes
+   *
+   * @param codes Codes that will be placed in the table
+   * @return unsigned Length of the longest code, capped at PRIMARY_BITS
+   */
+  static unsigned tableBits(const std::vector<PendingCode> &codes);
+};
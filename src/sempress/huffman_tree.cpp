@@ -3,102 +3,337 @@
  * @brief Implementation of the Huffman tree for data compression
  */
 #include "huffman_tree.hpp"
-#include <queue>
+#include "stats.hpp"
+#include <algorithm>
+#include <stdexcept>
 
 /**
- * @struct NodeCompare
- * @brief Functor for node comparison in the priority queue
+ * @brief Constructor: builds the Huffman tree from the frequency table file
  *
- * Defines the order of nodes in the min-heap based on frequency.
- * Nodes with lower frequency have higher priority.
+ * @param tablePath Path to the file containing the frequency table
+ * @param maxCodeLength Longest code allowed; 0 for no limit
  */
-struct NodeCompare {
-  /**
-   * @brief Comparison operator for Huffman tree nodes
-   *
-   * @param a First node to compare
-   * @param b Second node to compare
-   * @return true if the frequency of 'a' is greater than 'b' (for min-heap)
-   */
-  bool operator()(const std::shared_ptr<HuffmanNode> &a,
-                  const std::shared_ptr<HuffmanNode> &b) const {
-    return a->freq > b->freq;
-  }
-};
+HuffmanTree::HuffmanTree(const std::string &tablePath, unsigned maxCodeLength)
+    : HuffmanTree(loadFrequencyTable(tablePath), maxCodeLength) {}
 
 /**
  * @brief Constructor: builds the Huffman tree from character frequencies
  *
- * The algorithm builds the Huffman tree following these steps:
- * 1. Creates a leaf node for each character with its frequency
- * 2. Inserts all nodes into a min-heap (priority queue)
- * 3. While there is more than one node in the heap:
- *    - Removes the two nodes with the lowest frequency
- *    - Creates a new internal node with the sum of the frequencies
- *    - Inserts the new node into the heap
- * 4. The remaining node is the root of the tree
- * 5. Generates the code table by traversing the tree
+ * The algorithm follows these steps:
+ * 1. Computes the optimal code length of each symbol (computeLengths)
+ * 2. Assigns the canonical codes from the lengths
+ * 3. Lays out the node array that follows the canonical codes
+ *
+ * @param freq Symbols and their frequencies
+ * @param maxCodeLength Longest code allowed; 0 for no limit
+ *
+ * @note Complexity: O(n log n) where n is the number of distinct characters,
+ *       O(n * maxCodeLength) when the limit has to be enforced
+ */
+HuffmanTree::HuffmanTree(std::unordered_map<std::string, int> freq,
+                         unsigned maxCodeLength) {
+  Stats::PhaseTimer timer(Stats::TREE_BUILD);
+
+  // The end-of-file symbol is needed to mark the end of the data
+  freq.emplace("", 1);
+
+  std::vector<std::pair<std::string, uint64_t>> leaves;
+  leaves.reserve(freq.size());
+  for (const auto &[symbol, count] : freq) {
+    leaves.push_back({symbol, static_cast<uint64_t>(std::max(count, 0))});
+  }
+
+  buildCanonicalCodes(computeLengths(std::move(leaves), maxCodeLength));
+  buildTreeFromCodes();
+}
+
+/**
+ * @brief Constructor that rebuilds the codes from their lengths
+ *
+ * @param symbols Symbols, the end-of-file one being the empty string
+ * @param lengths Code length of each symbol
+ *
+ * @throws std::runtime_error If the lengths do not describe a prefix code
+ */
+HuffmanTree::HuffmanTree(const std::vector<std::string> &symbols,
+                         const std::vector<unsigned> &lengths) {
+  Stats::PhaseTimer timer(Stats::TREE_BUILD);
+  if (symbols.size() != lengths.size() or symbols.empty()) {
+    throw std::runtime_error("Invalid code length list.");
+  }
+
+  std::vector<std::pair<std::string, unsigned>> pairs;
+  pairs.reserve(symbols.size());
+  for (size_t i = 0; i < symbols.size(); i++) {
+    if (lengths[i] == 0) throw std::runtime_error("Invalid code length list.");
+    pairs.push_back({symbols[i], lengths[i]});
+  }
+  buildCanonicalCodes(std::move(pairs));
+}
+
+/**
+ * @brief Computes optimal code lengths from the symbol frequencies
+ *
+ * Sorts the leaves by frequency once and runs the two-queue construction
+ * of the Huffman tree (lengthsFromSortedWeights) in arrays allocated up
+ * front. Leaves of equal frequency are ordered by symbol, so the lengths
+ * are always the same for the same table.
+ *
+ * If the deepest leaf is longer than maxLength, the lengths are computed
+ * again by packageMerge(), which is slower but respects the limit.
+ *
+ * @param leaves Symbols and their frequencies
+ * @param maxLength Longest code allowed; 0 for no limit
+ * @return std::vector<std::pair<std::string, unsigned>> Symbols and the
+ *         lengths of their codes
+ *
+ * @throws std::runtime_error If 2^maxLength is less than the number of symbols
+ *
+ * @note A single symbol gets length 1, so every code has at least one bit
+ */
+std::vector<std::pair<std::string, unsigned>>
+HuffmanTree::computeLengths(std::vector<std::pair<std::string, uint64_t>> leaves,
+                            unsigned maxLength) {
+  std::sort(leaves.begin(), leaves.end(), [](const auto &a, const auto &b) {
+    return a.second != b.second ? a.second < b.second : a.first < b.first;
+  });
+
+  const size_t n = leaves.size();
+  std::vector<std::pair<std::string, unsigned>> lengths(n);
+  if (n == 0) return lengths;
+
+  if (maxLength > 0 and (maxLength < 64 and n > (uint64_t{1} << maxLength))) {
+    throw std::runtime_error("Maximum code length too small for " +
+                             std::to_string(n) + " symbols.");
+  }
+
+  std::vector<uint64_t> weights(n), work(2 * n - 1);
+  std::vector<uint32_t> parent(2 * n - 1);
+  std::vector<unsigned> depths(n);
+  for (size_t i = 0; i < n; i++) weights[i] = leaves[i].second;
+  lengthsFromSortedWeights(weights.data(), n, work.data(), parent.data(), depths.data());
+
+  const unsigned deepest = *std::max_element(depths.begin(), depths.end());
+  if (maxLength > 0 and deepest > maxLength) depths = packageMerge(weights, maxLength);
+
+  for (size_t i = 0; i < n; i++) lengths[i] = {std::move(leaves[i].first), depths[i]};
+  return lengths;
+}
+
+/**
+ * @brief Computes Huffman code lengths in caller-provided storage
  *
- * @param freq Unordered map containing characters and their frequencies
+ * The internal nodes are created in non-decreasing weight order, so the
+ * two lowest nodes are always at the front of the leaf queue or of the
+ * internal one; both queues live in work. The depth of each node is its
+ * parent's plus one, computed in one backwards pass since parents are
+ * created after their children. Ties prefer leaves.
  *
- * @note Complexity: O(n log n) where n is the number of distinct characters
- * @note Characters with zero frequency are ignored
+ * @param weights Weights of the n leaves, in non-decreasing order
+ * @param n Number of leaves
+ * @param work Scratch array of 2n - 1 weights
+ * @param parent Scratch array of 2n - 1 node indices
+ * @param lengths Receives the code length of each leaf (at least 1)
  */
-HuffmanTree::HuffmanTree(const std::string &tablePath) {
-  const std::unordered_map<std::string, int> freq = loadFrequencyTable(tablePath);
-  // Priority queue (min-heap) to build the Huffman tree
-  std::priority_queue<std::shared_ptr<HuffmanNode>,
-                      std::vector<std::shared_ptr<HuffmanNode>>, NodeCompare>
-      pq;
-
-  // Create leaf nodes for each character and insert into the priority queue
-  for (auto &[sym, f] : freq) {
-    pq.push(std::make_shared<HuffmanNode>(sym, f));
+void HuffmanTree::lengthsFromSortedWeights(const uint64_t *weights, size_t n,
+                                           uint64_t *work, uint32_t *parent,
+                                           unsigned *lengths) {
+  if (n == 0) return;
+
+  // work[i] and parent[i] of leaf i (i < n) and internal node i (i >= n)
+  for (size_t i = 0; i < n; i++) work[i] = weights[i];
+
+  size_t nextLeaf = 0, nextInternal = n, created = n;
+  auto popLowest = [&]() {
+    if (nextLeaf < n and (nextInternal == created or
+                          work[nextLeaf] <= work[nextInternal])) {
+      return nextLeaf++;
+    }
+    return nextInternal++;
+  };
+
+  // Combines the two nodes with the lowest weight until only one remains
+  while (created < 2 * n - 1) {
+    size_t left = popLowest();
+    size_t right = popLowest();
+    work[created] = work[left] + work[right];
+    parent[left] = parent[right] = static_cast<uint32_t>(created);
+    created++;
   }
 
-  // Build the tree by combining the two nodes with the lowest frequency until only one remains
-  while (pq.size() > 1) {
-    // Remove the two nodes with the lowest frequency
-    auto left = pq.top(); pq.pop();
-    auto right = pq.top(); pq.pop();
+  // The depth of each leaf is the length of its code; work is reused
+  work[2 * n - 2] = 0;
+  for (size_t i = 2 * n - 2; i-- > 0;) work[i] = work[parent[i]] + 1;
 
-    // Create a new internal node with the sum of the frequencies
-    pq.push(std::make_shared<HuffmanNode>(left, right));
+  for (size_t i = 0; i < n; i++) {
+    lengths[i] = std::max(static_cast<unsigned>(work[i]), 1u);
   }
+}
+
+/**
+ * @brief Computes optimal code lengths no longer than a limit
+ *
+ * Package-merge: the list of level maxLength holds the symbols sorted by
+ * weight. Each level above holds the symbols merged with the packages
+ * made by pairing the items of the level below. Taking the 2n - 2 lightest
+ * items of the top level, then, level by level, the items their packages
+ * were made of, every symbol is taken once per bit of its code. The
+ * lightest items of a level are always a prefix of its list, so only the
+ * leaf/package layout of each level is kept.
+ *
+ * @param weights Frequencies of the symbols, in non-decreasing order
+ * @param maxLength Longest code allowed (2^maxLength >= number of symbols)
+ * @return std::vector<unsigned> Code length of each symbol
+ *
+ * @note Complexity: O(n * maxLength) time and space
+ */
+std::vector<unsigned> HuffmanTree::packageMerge(const std::vector<uint64_t> &weights,
+                                                unsigned maxLength) {
+  const size_t n = weights.size();
+  std::vector<unsigned> lengths(n, 0);
+  if (n < 2) {
+    lengths.assign(n, 1);
+    return lengths;
+  }
+
+  // isPackage[level][i] tells whether item i of a level is a package; the
+  // last level holds only the symbols
+  std::vector<std::vector<bool>> isPackage(maxLength);
+  isPackage[maxLength - 1].assign(n, false);
+  std::vector<uint64_t> items = weights, merged;
+
+  for (unsigned level = maxLength - 1; level-- > 0;) {
+    // Pairs the items of the level below; an odd item out is dropped
+    const size_t packages = items.size() / 2;
+    merged.clear();
+    merged.reserve(n + packages);
+    std::vector<bool> &layout = isPackage[level];
+    layout.clear();
+    layout.reserve(n + packages);
 
-  // The remaining node is the root of the Huffman tree
-  root = pq.top();
+    // Merges the packages into the symbols; ties keep the symbol first
+    size_t leaf = 0, package = 0;
+    while (leaf < n or package < packages) {
+      const uint64_t packed = package < packages
+                                  ? items[2 * package] + items[2 * package + 1]
+                                  : UINT64_MAX;
+      if (package == packages or (leaf < n and weights[leaf] <= packed)) {
+        merged.push_back(weights[leaf++]);
+        layout.push_back(false);
+      } else {
+        merged.push_back(packed);
+        layout.push_back(true);
+        package++;
+      }
+    }
+    std::swap(items, merged);
+  }
 
-  // Build the code table by traversing the tree from the root
-  buildCodes(root, "");
+  // Follows the selected items down the levels
+  size_t selected = 2 * n - 2;
+  for (unsigned level = 0; level < maxLength and selected > 0; level++) {
+    const std::vector<bool> &layout = isPackage[level];
+    size_t leaves = 0, packages = 0;
+    for (size_t i = 0; i < selected; i++) {
+      if (layout[i]) {
+        packages++;
+      } else {
+        lengths[leaves++]++;
+      }
+    }
+    selected = 2 * packages;
+  }
+  return lengths;
 }
 
 /**
- * @brief Recursively builds the Huffman code table
+ * @brief Assigns canonical codes from the code length of each symbol
+ *
+ * The running code is kept as a string, since zero-frequency symbols may
+ * get codes longer than a packed word; its buffer is reused from one
+ * symbol to the next. Codes that fit are packed, the others are kept in
+ * longCodes.
  *
- * Traverses the tree in pre-order assigning:
- * - '0' for left traversal
- * - '1' for right traversal
+ * @param lengths Symbols and their code lengths
  *
- * @param node Current node being processed
- * @param code Binary code accumulated up to the current node
+ * @throws std::runtime_error If the lengths do not describe a prefix code
+ */
+void HuffmanTree::buildCanonicalCodes(
+    std::vector<std::pair<std::string, unsigned>> lengths) {
+  std::sort(lengths.begin(), lengths.end(), [](const auto &a, const auto &b) {
+    return a.second != b.second ? a.second < b.second : a.first < b.first;
+  });
+
+  symbols.clear();
+  codes.clear();
+  longCodes.clear();
+  eofSymbol = -1;
+  symbols.reserve(lengths.size());
+  codes.reserve(lengths.size());
+
+  std::string code;
+  for (size_t i = 0; i < lengths.size(); i++) {
+    auto &[symbol, length] = lengths[i];
+
+    if (i > 0) {
+      // Next code: previous code plus one...
+      size_t bit = code.length();
+      while (bit > 0 and code[bit - 1] == '1') code[--bit] = '0';
+      if (bit == 0) throw std::runtime_error("Invalid code length list.");
+      code[bit - 1] = '1';
+    }
+    // ...shifted left to the length of the current symbol
+    code.resize(length, '0');
+
+    if (i > 0 and symbol == symbols.back()) {
+      throw std::runtime_error("Duplicated symbol in code table.");
+    }
+
+    // Packs the code into an integer for the bit writer
+    HuffmanCode packed;
+    packed.length = static_cast<uint16_t>(length);
+    if (packed.isPacked()) {
+      for (char bit : code) packed.bits = (packed.bits << 1) | (bit == '1');
+    } else {
+      longCodes[static_cast<int>(symbols.size())] = code;
+    }
+    if (symbol.empty()) eofSymbol = static_cast<int>(symbols.size());
+    symbols.push_back(std::move(symbol));
+    codes.push_back(packed);
+  }
+
+  if (eofSymbol < 0) throw std::runtime_error("Code table has no EOF symbol.");
+}
+
+/**
+ * @brief Builds the node array so that walking it follows the canonical
+ * codes
  *
- * @note When a leaf is reached, the accumulated code is stored in the table
- * @note The root has an empty code, which expands to the codes of the children
+ * Inserts the code of each symbol into an empty tree, creating internal
+ * nodes along the way. A prefix code over k symbols has at most 2k - 1
+ * nodes, so the array is reserved once and never reallocates.
  */
-void HuffmanTree::buildCodes(std::shared_ptr<HuffmanNode> node,
-                             const std::string &code) {
-  // Base case: null node, return without doing anything
-  if (not node) return;
-
-  // If it's a leaf node, store the code in the table
-  if (node->isLeaf()) {
-    codeTable[node->symbol] = code;
-  } else {
-    // Recursively traverse the left subtree adding '0' to the code
-    buildCodes(node->left, code + "0");
-    // Recursively traverse the right subtree adding '1' to the code
-    buildCodes(node->right, code + "1");
+void HuffmanTree::buildTreeFromCodes() {
+  nodes.clear();
+  nodes.reserve(2 * symbols.size());
+  nodes.emplace_back();
+
+  for (size_t id = 0; id < symbols.size(); id++) {
+    const HuffmanCode &code = codes[id];
+    const std::string *wide = code.isPacked() ? nullptr : &longCodes.at(static_cast<int>(id));
+
+    int32_t node = 0;
+    for (unsigned i = 0; i < code.length; i++) {
+      bool one = wide ? (*wide)[i] == '1' : (code.bits >> (code.length - 1 - i)) & 1;
+      int32_t next = one ? nodes[node].right : nodes[node].left;
+      if (next == HuffmanNode::NONE) {
+        next = static_cast<int32_t>(nodes.size());
+        nodes.emplace_back();
+        (one ? nodes[node].right : nodes[node].left) = next;
+      }
+      node = next;
+    }
+    nodes[node].symbol = static_cast<int32_t>(id);
   }
 }
 
@@ -110,15 +345,27 @@ void HuffmanTree::buildCodes(std::shared_ptr<HuffmanNode> node,
  *
  * @return std::unordered_map<std::string, std::string> Encoding table
  *
- * @note The table is generated during tree construction
  * @note The code is a string of '0's and '1's
  * @note No code is a prefix of another (Huffman code property)
  */
 std::unordered_map<std::string, std::string> HuffmanTree::getCodeTable() const {
+  std::unordered_map<std::string, std::string> codeTable;
+  for (size_t id = 0; id < symbols.size(); id++) {
+    codeTable[symbols[id]] = getCodeString(static_cast<int>(id));
+  }
   return codeTable;
 }
 
-std::shared_ptr<HuffmanNode> HuffmanTree::getRoot() const { return root; }
+std::string HuffmanTree::getCodeString(int symbol) const {
+  const HuffmanCode &code = codes[symbol];
+  if (not code.isPacked()) return longCodes.at(symbol);
+
+  std::string bits(code.length, '0');
+  for (unsigned i = 0; i < code.length; i++) {
+    if ((code.bits >> (code.length - 1 - i)) & 1) bits[i] = '1';
+  }
+  return bits;
+}
 
 /**
  * @brief Loads a frequency table from a file
@@ -146,7 +393,7 @@ HuffmanTree::loadFrequencyTable(const std::string &tablePath) {
     // Ignore empty lines
     if (line.empty()) continue;
 
-    size_t sep;
+    size_t sep = std::string::npos;
     // Find the ':' separator between character and frequency
     for (int i = line.size() - 1; i >= 0; i--) {
       if (line[i] == ':') {
@@ -154,6 +401,8 @@ HuffmanTree::loadFrequencyTable(const std::string &tablePath) {
         break;
       }
     }
+    // Ignore malformed lines
+    if (sep == std::string::npos) continue;
 
     // Split the line into symbol and frequency
     std::string symbolStr = line.substr(0, sep);
@@ -170,8 +419,9 @@ HuffmanTree::loadFrequencyTable(const std::string &tablePath) {
 
   tableFile.close();
 
-  // Add an end-of-file (EOF) symbol to handle padding
-  freq["EOF"] = 1;
+  // Add an end-of-file (EOF) symbol to handle padding; the empty string
+  // keeps it apart from every symbol that can appear in the input
+  freq[""] = 1;
 
   return freq;
 }
\ No newline at end of file
@@ -4,54 +4,58 @@
  * data compression
  */
 #pragma once
+#include <cstdint>
 #include <fstream>
-#include <memory>
-#include <queue>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 /**
- * @struct HuffmanNode
- * @brief Structure representing a node in the Huffman tree
+ * @struct HuffmanCode
+ * @brief Huffman code packed into an integer
  *
- * Each node can be a leaf (containing a symbol) or an internal node
- * (containing references to left and right subtrees).
+ * The code is right-aligned in bits, with its first bit being the most
+ * significant of the length used bits. Codes longer than MAX_PACKED_LENGTH
+ * do not fit in the word and keep bits at zero; they are kept in string
+ * form by the tree (see HuffmanTree::getCodeString).
  */
-struct HuffmanNode {
-  std::string symbol;   ///< Character stored in the node (only for leaves)
-  int freq;    ///< Frequency of the character or sum of the children's frequencies
-  std::shared_ptr<HuffmanNode> left;  ///< Pointer to the left child
-  std::shared_ptr<HuffmanNode> right; ///< Pointer to the right child
+struct HuffmanCode {
+  static constexpr unsigned MAX_PACKED_LENGTH = 64; ///< Longest packed code
 
-  /**
-   * @brief Constructor for leaf node
-   *
-   * Creates a leaf node containing a symbol and its frequency.
-   *
-   * @param s Character to be stored in the node
-   * @param f Frequency of the character
-   */
-  HuffmanNode(std::string s, int f)
-      : symbol(s), freq(f), left(nullptr), right(nullptr) {}
+  uint64_t bits = 0;  ///< Code bits, right-aligned
+  uint16_t length = 0; ///< Number of bits of the code
 
   /**
-   * @brief Constructor for internal node
-   *
-   * Creates an internal node that combines two child nodes. The frequency
-   * of the internal node is the sum of the children's frequencies.
+   * @brief Checks if the code fits in the packed word
    *
-   * @param l Pointer to the left child node
-   * @param r Pointer to the right child node
+   * @return true if bits holds the whole code
    */
-  HuffmanNode(std::shared_ptr<HuffmanNode> l, std::shared_ptr<HuffmanNode> r)
-      : symbol(""), freq(l->freq + r->freq), left(l), right(r) {}
+  bool isPacked() const { return length <= MAX_PACKED_LENGTH; }
+};
+
+/**
+ * @struct HuffmanNode
+ * @brief Structure representing a node in the Huffman tree
+ *
+ * Nodes live in one contiguous array owned by the tree and refer to each
+ * other by index. Each node can be a leaf (holding the id of a symbol in
+ * the symbol table of the tree) or an internal node (holding the indices
+ * of its left and right children).
+ */
+struct HuffmanNode {
+  static constexpr int32_t NONE = -1; ///< Missing child or symbol
+
+  int32_t left = NONE;   ///< Index of the left child (bit '0')
+  int32_t right = NONE;  ///< Index of the right child (bit '1')
+  int32_t symbol = NONE; ///< Symbol id (only for leaves)
 
   /**
    * @brief Checks if the node is a leaf
    *
    * @return true if the node has no children, false otherwise
    */
-  bool isLeaf() const { return not left && not right; }
+  bool isLeaf() const { return left == NONE and right == NONE; }
 };
 
 /**
@@ -61,58 +65,202 @@ struct HuffmanNode {
  * The Huffman tree is an optimal binary tree for encoding
  * where more frequent characters have shorter codes.
  *
+ * Only the code length of each symbol is taken from the tree built from
+ * the frequencies. The codes themselves are canonical: symbols are sorted
+ * by (code length, symbol bytes) and receive consecutive codes, so the
+ * whole code table can be rebuilt from the list of code lengths alone.
+ *
+ * The end-of-file symbol is always present and is represented by the
+ * empty string, so it can never be matched in the input.
+ *
  * @note The tree follows the prefix property: no code is
  *       a prefix of another code, allowing unique decoding.
  */
 class HuffmanTree {
 private:
-  std::shared_ptr<HuffmanNode> root; ///< Root of the Huffman tree
-  std::unordered_map<std::string, std::string>
-      codeTable; ///< Encoding table character->code
+  std::vector<HuffmanNode> nodes;   ///< Node array, the root first
+  std::vector<std::string> symbols; ///< Symbols indexed by symbol id
+  std::vector<HuffmanCode> codes;   ///< Packed codes indexed by symbol id
+  std::unordered_map<int, std::string>
+      longCodes;      ///< Codes that do not fit in a packed word, by symbol id
+  int eofSymbol = -1; ///< Id of the end-of-file symbol
 
   /**
-   * @brief Builds the code table by recursively traversing the tree
+   * @brief Computes optimal code lengths from the symbol frequencies
    *
-   * Assigns '0' for left branching and '1' for right branching.
+   * @param leaves Symbols and their frequencies
+   * @param maxLength Longest code allowed; 0 for no limit
+   * @return std::vector<std::pair<std::string, unsigned>> Symbols and the
+   *         lengths of their codes
+   */
+  static std::vector<std::pair<std::string, unsigned>>
+  computeLengths(std::vector<std::pair<std::string, uint64_t>> leaves,
+                 unsigned maxLength);
+
+  /**
+   * @brief Computes optimal code lengths no longer than a limit
+   *
+   * @param weights Frequencies of the symbols, in non-decreasing order
+   * @param maxLength Longest code allowed
+   * @return std::vector<unsigned> Code length of each symbol
+   */
+  static std::vector<unsigned> packageMerge(const std::vector<uint64_t> &weights,
+                                            unsigned maxLength);
+
+  /**
+   * @brief Assigns canonical codes from the code length of each symbol
+   *
+   * Sorts the symbols by (length, symbol) and gives each one the previous
+   * code plus one, shifted left to its own length. Fills symbols, codes
+   * and longCodes.
+   *
+   * @param lengths Symbols and their code lengths
+   */
+  void buildCanonicalCodes(std::vector<std::pair<std::string, unsigned>> lengths);
+
+  /**
+   * @brief Builds the node array so that walking it follows the canonical
+   * codes
    *
-   * @param node Current node being processed
-   * @param code Binary code accumulated up to the current node
+   * Assigns '0' for left branching and '1' for right branching.
    */
-  void buildCodes(std::shared_ptr<HuffmanNode> node, const std::string &code);
+  void buildTreeFromCodes();
 
 public:
   /**
    * @brief Default constructor - creates an empty tree
    */
-  HuffmanTree() : root(nullptr) {}
+  HuffmanTree() = default;
 
   /**
    * @brief Constructor that creates the tree from a frequency table
    *
-   * Builds the optimal Huffman tree using a greedy algorithm based
-   * on a priority queue (min-heap).
+   * Builds the optimal Huffman tree from the frequencies, then derives
+   * canonical codes from the depth of each leaf.
+   *
+   * @param tablePath Path to the file containing the frequency table
+   * @param maxCodeLength Longest code allowed; 0 for no limit
    *
-   * @param freq Unordered map containing characters and their frequencies
+   * @throws std::runtime_error If the table has more symbols than codes of
+   *         maxCodeLength bits can tell apart
    */
-  HuffmanTree(const std::string &tablePath);
+  HuffmanTree(const std::string &tablePath, unsigned maxCodeLength = 0);
+
+  /**
+   * @brief Constructor that creates the tree from in-memory frequencies
+   *
+   * With a maximum code length, the lengths are the optimal ones among the
+   * codes that respect it, so decoders can size their tables by it.
+   *
+   * @param freq Symbols and their frequencies; the end-of-file symbol
+   *        (empty string) is added with frequency 1 if missing
+   * @param maxCodeLength Longest code allowed; 0 for no limit
+   *
+   * @throws std::runtime_error If there are more symbols than codes of
+   *         maxCodeLength bits can tell apart
+   */
+  explicit HuffmanTree(std::unordered_map<std::string, int> freq,
+                       unsigned maxCodeLength = 0);
+
+  /**
+   * @brief Constructor that rebuilds the codes from their lengths
+   *
+   * No tree is allocated: getNodes() is empty for trees built this way.
+   *
+   * @param symbols Symbols, the end-of-file one being the empty string
+   * @param lengths Code length of each symbol
+   *
+   * @throws std::runtime_error If the lengths do not describe a prefix code
+   */
+  HuffmanTree(const std::vector<std::string> &symbols,
+              const std::vector<unsigned> &lengths);
 
   /**
    * @brief Returns the encoding table generated by the tree
    *
+   * Built on each call; the hot paths use getCodes() instead.
+   *
    * @return std::unordered_map<std::string, std::string> Table mapping each
    *         character to its corresponding binary code
    *
    * @note Codes are strings containing only '0' and '1'
    * @note Characters not present in the tree will not be in the table
+   * @note The end-of-file symbol is stored under the empty string
    */
   std::unordered_map<std::string, std::string> getCodeTable() const;
 
   /**
-   * @brief Returns the root of the Huffman tree
+   * @brief Returns the code of a symbol as a string of '0's and '1's
+   *
+   * @param symbol Symbol id
+   * @return std::string Binary code of the symbol
+   */
+  std::string getCodeString(int symbol) const;
+
+  /**
+   * @brief Returns the symbols of the tree indexed by symbol id
+   *
+   * Ids follow the canonical order, and index the vector returned by
+   * getCodes().
+   *
+   * @return const std::vector<std::string>& Symbols of the tree
+   */
+  const std::vector<std::string> &getSymbols() const { return symbols; }
+
+  /**
+   * @brief Returns the packed codes indexed by symbol id
    *
-   * @return std::shared_ptr<HuffmanNode> Pointer to the root node
+   * @return const std::vector<HuffmanCode>& Packed code of each symbol
    */
-  std::shared_ptr<HuffmanNode> getRoot() const;
+  const std::vector<HuffmanCode> &getCodes() const { return codes; }
+
+  /**
+   * @brief Returns the length of the longest code
+   *
+   * @return unsigned Number of bits, 0 for an empty tree
+   */
+  unsigned getMaxCodeLength() const {
+    return codes.empty() ? 0 : codes.back().length;
+  }
+
+  /**
+   * @brief Returns the id of the end-of-file symbol
+   *
+   * @return int Symbol id
+   */
+  int getEofSymbol() const { return eofSymbol; }
+
+  /**
+   * @brief Returns the node array of the tree
+   *
+   * @return const std::vector<HuffmanNode>& Nodes, the root at index 0
+   */
+  const std::vector<HuffmanNode> &getNodes() const { return nodes; }
+
+  /**
+   * @brief Returns the index of the root of the Huffman tree
+   *
+   * @return int32_t Index of the root, or HuffmanNode::NONE if the tree
+   *         has no nodes
+   */
+  int32_t getRoot() const { return nodes.empty() ? HuffmanNode::NONE : 0; }
+
+  /**
+   * @brief Computes Huffman code lengths in caller-provided storage
+   *
+   * Two-queue construction over weights sorted in non-decreasing order;
+   * nothing is allocated, so callers that rebuild codes often can reuse
+   * their arrays.
+   *
+   * @param weights Weights of the n leaves, in non-decreasing order
+   * @param n Number of leaves
+   * @param work Scratch array of 2n - 1 weights
+   * @param parent Scratch array of 2n - 1 node indices
+   * @param lengths Receives the code length of each leaf (at least 1)
+   */
+  static void lengthsFromSortedWeights(const uint64_t *weights, size_t n,
+                                       uint64_t *work, uint32_t *parent,
+                                       unsigned *lengths);
 
    /**
    * @brief Loads a frequency table from a text file
@@ -125,6 +273,6 @@ public:
    * @return std::unordered_map<std::string, int> Map containing the symbols and their
    * respective frequencies
    */
-  std::unordered_map<std::string, int>
+  static std::unordered_map<std::string, int>
   loadFrequencyTable(const std::string &tablePath);
-};
\ No newline at end of file
+};
@@ -0,0 +1,98 @@
+/**
+ * @file input_window.cpp
+ * @brief Implementation of the sliding input window
+ */
+#include "input_window.hpp"
+#include "stats.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+InputWindow::InputWindow(std::istream &in, size_t capacity, uint64_t limit)
+    : in(in), buffer(capacity), eof(limit == 0), remaining(limit) {}
+
+/**
+ * @brief Keeps the unconsumed bytes and reads until the buffer is full
+ * or the input ends
+ *
+ * @return true if there are bytes in the window, false when all the
+ *         input was consumed
+ * @throws std::runtime_error If the stream fails while reading
+ */
+bool InputWindow::fill() {
+  Stats::PhaseTimer timer(Stats::IO);
+  compact();
+
+  while (not eof and end < buffer.size()) {
+    in.read(buffer.data() + end, room());
+    taken(static_cast<size_t>(in.gcount()));
+    if (not in) {
+      if (in.bad()) throw std::runtime_error("Error reading input.");
+      eof = true;
+    }
+  }
+
+  return end > start;
+}
+
+/**
+ * @brief Keeps the unconsumed bytes and reads only what the stream can
+ * give without waiting
+ *
+ * @return true if there are bytes in the window, false when all the
+ *         input was consumed
+ * @throws std::runtime_error If the stream fails while reading
+ */
+bool InputWindow::fillAvailable() {
+  Stats::PhaseTimer timer(Stats::IO);
+  compact();
+  if (eof or end == buffer.size()) return end > start;
+
+  // Only the first byte may wait; readsome never does
+  in.read(buffer.data() + end, 1);
+  taken(static_cast<size_t>(in.gcount()));
+  if (not in) {
+    if (in.bad()) throw std::runtime_error("Error reading input.");
+    eof = true;
+    return end > start;
+  }
+
+  while (not eof and end < buffer.size()) {
+    const std::streamsize read = in.readsome(buffer.data() + end, room());
+    if (in.bad()) throw std::runtime_error("Error reading input.");
+    if (read <= 0) break;
+    taken(static_cast<size_t>(read));
+  }
+  return true;
+}
+
+/**
+ * @brief Moves the unconsumed tail to the front of the buffer
+ */
+void InputWindow::compact() {
+  if (start > 0) {
+    std::memmove(buffer.data(), buffer.data() + start, end - start);
+    end -= start;
+    start = 0;
+  }
+}
+
+/**
+ * @brief Returns the free room of the buffer, capped at the limit
+ *
+ * @return std::streamsize Bytes to ask the stream for
+ */
+std::streamsize InputWindow::room() const {
+  return static_cast<std::streamsize>(std::min<uint64_t>(buffer.size() - end, remaining));
+}
+
+/**
+ * @brief Adds bytes just read to the window and to the limit
+ *
+ * @param n Number of bytes read
+ */
+void InputWindow::taken(size_t n) {
+  end += n;
+  remaining -= n;
+  if (remaining == 0) eof = true;
+}
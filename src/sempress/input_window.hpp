@@ -0,0 +1,119 @@
+/**
+ * @file input_window.hpp
+ * @brief Definition of the InputWindow class, a fixed-size sliding window
+ * over an input stream
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <vector>
+
+/**
+ * @class InputWindow
+ * @brief Reads an input stream through a fixed-size buffer
+ *
+ * The caller processes the bytes of the window, consumes the ones it is
+ * done with and calls fill() again. The unconsumed tail is moved to the
+ * front of the buffer before reading more, so a token that starts near
+ * the end of one fill is still whole in the next one. Memory use depends
+ * only on the capacity, never on the size of the input.
+ */
+class InputWindow {
+public:
+  /**
+   * @brief Creates a window over a stream
+   *
+   * @param in Input stream, read in binary chunks
+   * @param capacity Size of the buffer in bytes
+   * @param limit Bytes to read at most; the input ends there
+   */
+  InputWindow(std::istream &in, size_t capacity, uint64_t limit = UINT64_MAX);
+
+  /**
+   * @brief Keeps the unconsumed bytes and reads until the buffer is full
+   * or the input ends
+   *
+   * @return true if there are bytes in the window, false when all the
+   *         input was consumed
+   * @throws std::runtime_error If the stream fails while reading
+   */
+  bool fill();
+
+  /**
+   * @brief Keeps the unconsumed bytes and reads only what the stream can
+   * give without waiting
+   *
+   * Waits for one byte at most, then takes the bytes the stream already
+   * holds (buffered, or pending in a pipe), so a live input is processed
+   * as it arrives instead of once a whole window has come.
+   *
+   * @return true if there are bytes in the window, false when all the
+   *         input was consumed
+   * @throws std::runtime_error If the stream fails while reading
+   */
+  bool fillAvailable();
+
+  /**
+   * @brief Checks if the stream holds no byte that can be read without
+   * waiting
+   *
+   * @return true if the next read would wait for more input
+   */
+  bool idle() const { return eof or in.rdbuf()->in_avail() <= 0; }
+
+  /**
+   * @brief Returns the first unconsumed byte
+   *
+   * @return const char* Pointer into the buffer
+   */
+  const char *data() const { return buffer.data() + start; }
+
+  /**
+   * @brief Returns the number of unconsumed bytes in the window
+   *
+   * @return size_t Number of bytes
+   */
+  size_t size() const { return end - start; }
+
+  /**
+   * @brief Marks bytes at the front of the window as processed
+   *
+   * @param n Number of bytes, at most size()
+   */
+  void consume(size_t n) { start += n; }
+
+  /**
+   * @brief Checks if the whole input has been read into the window
+   *
+   * @return true if no more bytes will come from the stream
+   */
+  bool atEnd() const { return eof; }
+
+private:
+  std::istream &in;         ///< Stream being read
+  std::vector<char> buffer; ///< Window storage
+  size_t start = 0;         ///< First unconsumed byte
+  size_t end = 0;           ///< End of the bytes read so far
+  bool eof = false;         ///< Whether the stream is exhausted
+  uint64_t remaining;       ///< Bytes that may still be read
+
+  /**
+   * @brief Moves the unconsumed tail to the front of the buffer
+   */
+  void compact();
+
+  /**
+   * @brief Returns the free room of the buffer, capped at the limit
+   *
+   * @return std::streamsize Bytes to ask the stream for
+   */
+  std::streamsize room() const;
+
+  /**
+   * @brief Adds bytes just read to the window and to the limit
+   *
+   * @param n Number of bytes read
+   */
+  void taken(size_t n);
+};
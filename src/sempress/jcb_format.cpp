@@ -0,0 +1,341 @@
+/**
+ * @file jcb_format.cpp
+ * @brief Implementation of the .jcb header reader and writer
+ */
+#include "jcb_format.hpp"
+#include "byte_order.hpp"
+#include "stats.hpp"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const char MAGIC[3] = {'J', 'C', 'B'};
+static const char INDEX_MAGIC[4] = {'J', 'C', 'B', 'X'};
+
+/**
+ * @brief Appends the symbol count and the symbols of a tree to a header
+ *
+ * @param header Header being built
+ * @param tree Huffman tree whose codes are described
+ *
+ * @throws std::runtime_error If a symbol or a code does not fit the header
+ */
+static void appendCodes(std::string &header, const HuffmanTree &tree) {
+  const std::vector<std::string> &symbols = tree.getSymbols();
+  const std::vector<HuffmanCode> &codes = tree.getCodes();
+
+  if (symbols.size() > UINT16_MAX) {
+    throw std::runtime_error("Too many symbols for the compressed header.");
+  }
+
+  header += static_cast<char>(symbols.size() & 0xFF);
+  header += static_cast<char>(symbols.size() >> 8);
+
+  for (size_t id = 0; id < symbols.size(); id++) {
+    if (codes[id].length > UINT8_MAX or symbols[id].length() > UINT8_MAX) {
+      throw std::runtime_error("Symbol or code too long for the compressed header.");
+    }
+    header += static_cast<char>(codes[id].length);
+    header += static_cast<char>(symbols[id].length());
+    header += symbols[id];
+  }
+}
+
+/**
+ * @brief Reads a symbol count and the symbols it announces
+ *
+ * @param in Input stream, positioned at the symbol count
+ * @return HuffmanTree Tree rebuilt from the code lengths (no nodes)
+ *
+ * @throws std::runtime_error If the header is truncated or malformed
+ */
+static HuffmanTree readCodes(std::istream &in) {
+  unsigned char countBytes[2];
+  if (not in.read(reinterpret_cast<char *>(countBytes), sizeof(countBytes))) {
+    throw std::runtime_error("Truncated compressed header.");
+  }
+
+  size_t count = countBytes[0] | (static_cast<size_t>(countBytes[1]) << 8);
+  std::vector<std::string> symbols(count);
+  std::vector<unsigned> lengths(count);
+
+  for (size_t id = 0; id < count; id++) {
+    unsigned char sizes[2];
+    if (not in.read(reinterpret_cast<char *>(sizes), sizeof(sizes))) {
+      throw std::runtime_error("Truncated compressed header.");
+    }
+    lengths[id] = sizes[0];
+    symbols[id].resize(sizes[1]);
+    if (not in.read(&symbols[id][0], sizes[1])) {
+      throw std::runtime_error("Truncated compressed header.");
+    }
+  }
+
+  return HuffmanTree(symbols, lengths);
+}
+
+/**
+ * @brief Writes the header describing the codes of a tree
+ *
+ * @param out Output stream, positioned at the start of the file
+ * @param tree Huffman tree used to encode the data
+ * @param flags Layout flags of the data that follows
+ *
+ * @throws std::runtime_error If a symbol or a code does not fit the header
+ */
+void JcbFormat::writeHeader(std::ostream &out, const HuffmanTree &tree,
+                            uint8_t flags) {
+  std::string header(MAGIC, sizeof(MAGIC));
+  header += static_cast<char>(VERSION);
+  header += static_cast<char>(flags);
+  appendCodes(header, tree);
+
+  out.write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+/**
+ * @brief Writes the header describing the codes of several trees
+ *
+ * @param out Output stream, positioned at the start of the file
+ * @param trees Huffman trees the blocks are encoded with, by table id
+ * @param flags Layout flags of the data that follows
+ *
+ * @throws std::runtime_error If there are too many trees, or if a symbol
+ *         or a code does not fit the header
+ */
+void JcbFormat::writeHeader(std::ostream &out, const std::vector<HuffmanTree> &trees,
+                            uint8_t flags) {
+  if (trees.empty() or trees.size() > MAX_TABLES) {
+    throw std::runtime_error("Invalid number of tables for the compressed header.");
+  }
+  if (trees.size() > 1) flags |= FLAG_TABLES;
+
+  std::string header(MAGIC, sizeof(MAGIC));
+  header += static_cast<char>(VERSION);
+  header += static_cast<char>(flags);
+  appendCodes(header, trees[0]);
+
+  if (flags & FLAG_TABLES) {
+    header += static_cast<char>(trees.size() - 1);
+    for (size_t i = 1; i < trees.size(); i++) appendCodes(header, trees[i]);
+  }
+
+  out.write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+/**
+ * @brief Reads a header and rebuilds the codes it describes
+ *
+ * @param in Input stream, positioned at the start of the file
+ * @param flags Receives the layout flags of the data that follows
+ * @return HuffmanTree Tree rebuilt from the code lengths (no nodes)
+ *
+ * @throws std::runtime_error If the header is missing or malformed
+ */
+HuffmanTree JcbFormat::readHeader(std::istream &in, uint8_t &flags) {
+  return std::move(readTables(in, flags).front());
+}
+
+/**
+ * @brief Reads a header and rebuilds the codes of all its tables
+ *
+ * @param in Input stream, positioned at the start of the file
+ * @param flags Receives the layout flags of the data that follows
+ * @return std::vector<HuffmanTree> Trees rebuilt from the code lengths,
+ *         by table id
+ *
+ * @throws std::runtime_error If the header is missing or malformed
+ */
+std::vector<HuffmanTree> JcbFormat::readTables(std::istream &in, uint8_t &flags) {
+  Stats::PhaseTimer timer(Stats::TABLE_LOAD);
+  unsigned char fixed[5];
+  if (not in.read(reinterpret_cast<char *>(fixed), sizeof(fixed)) or
+      fixed[0] != MAGIC[0] or fixed[1] != MAGIC[1] or fixed[2] != MAGIC[2]) {
+    throw std::runtime_error("Not a compressed file (missing JCB header).");
+  }
+  if (fixed[3] != VERSION) {
+    throw std::runtime_error("Unsupported compressed file version " +
+                             std::to_string(fixed[3]) + ".");
+  }
+  flags = fixed[4];
+  if ((flags & ~KNOWN_FLAGS) or
+      ((flags & FLAG_TABLES) and not (flags & FLAG_BLOCKS)) or
+      ((flags & FLAG_DYNAMIC) and flags != FLAG_DYNAMIC)) {
+    throw std::runtime_error("Unsupported compressed file flags.");
+  }
+
+  std::vector<HuffmanTree> trees;
+  trees.push_back(readCodes(in));
+
+  if (flags & FLAG_TABLES) {
+    char others;
+    if (not in.get(others)) throw std::runtime_error("Truncated compressed header.");
+    for (size_t i = 0; i < static_cast<unsigned char>(others); i++) {
+      trees.push_back(readCodes(in));
+    }
+  }
+  return trees;
+}
+
+void JcbFormat::writeRebuildInterval(std::ostream &out, uint32_t interval) {
+  std::string bytes;
+  putUint32(bytes, interval);
+  out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+/**
+ * @brief Reads the rebuild interval, after a header with FLAG_DYNAMIC
+ *
+ * @param in Input stream, positioned after the symbols
+ * @return uint32_t Symbols between two rebuilds of the codes
+ *
+ * @throws std::runtime_error If the interval is missing or zero
+ */
+uint32_t JcbFormat::readRebuildInterval(std::istream &in) {
+  unsigned char bytes[4];
+  if (not in.read(reinterpret_cast<char *>(bytes), sizeof(bytes))) {
+    throw std::runtime_error("Truncated compressed header.");
+  }
+  const uint32_t interval = getUint32(bytes);
+  if (interval == 0) throw std::runtime_error("Invalid rebuild interval.");
+  return interval;
+}
+
+void JcbFormat::writeBlock(std::ostream &out, uint8_t flags, uint64_t rawSize,
+                           const std::vector<unsigned char> &payload,
+                           uint8_t table) {
+  if (rawSize > MAX_BLOCK_SIZE or payload.size() > MAX_BLOCK_SIZE) {
+    throw std::runtime_error("Block too large for its frame.");
+  }
+
+  std::string frame;
+  putUint32(frame, static_cast<uint32_t>(rawSize));
+  putUint32(frame, static_cast<uint32_t>(payload.size()));
+  if (flags & FLAG_TABLES) frame += static_cast<char>(table);
+  out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+  out.write(reinterpret_cast<const char *>(payload.data()),
+            static_cast<std::streamsize>(payload.size()));
+}
+
+void JcbFormat::writeEnd(std::ostream &out) {
+  std::string frame;
+  putUint32(frame, 0);
+  putUint32(frame, 0);
+  out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+}
+
+/**
+ * @brief Reads the next block frame
+ *
+ * @param in Input stream, positioned at a frame
+ * @param flags Layout flags of the file
+ * @param rawSize Receives the uncompressed size of the block
+ * @param payload Receives the encoded bit stream of the block
+ * @param table Receives the id of the table of the block
+ * @return true if a block was read, false at the end frame
+ *
+ * @throws std::runtime_error If the frame is truncated
+ */
+bool JcbFormat::readBlock(std::istream &in, uint8_t flags, uint64_t &rawSize,
+                          std::vector<unsigned char> &payload, uint8_t &table) {
+  uint64_t payloadSize;
+  if (not readFrame(in, flags, rawSize, payloadSize, table)) return false;
+
+  payload.resize(payloadSize);
+  if (not in.read(reinterpret_cast<char *>(payload.data()),
+                  static_cast<std::streamsize>(payload.size()))) {
+    throw std::runtime_error("Truncated block frame.");
+  }
+  return true;
+}
+
+/**
+ * @brief Reads the sizes of the next block frame, leaving the stream at
+ * its payload
+ *
+ * @param in Input stream, positioned at a frame
+ * @param flags Layout flags of the file
+ * @param rawSize Receives the uncompressed size of the block
+ * @param payloadSize Receives the size of the encoded bit stream
+ * @param table Receives the id of the table of the block
+ * @return true if a block follows, false at the end frame
+ *
+ * @throws std::runtime_error If the frame is truncated
+ */
+bool JcbFormat::readFrame(std::istream &in, uint8_t flags, uint64_t &rawSize,
+                          uint64_t &payloadSize, uint8_t &table) {
+  unsigned char frame[8];
+  if (not in.read(reinterpret_cast<char *>(frame), sizeof(frame))) {
+    throw std::runtime_error("Truncated block frame.");
+  }
+
+  rawSize = getUint32(frame);
+  payloadSize = getUint32(frame + 4);
+  table = 0;
+  if (rawSize == 0 and payloadSize == 0) return false;
+
+  if (flags & FLAG_TABLES) {
+    char id;
+    if (not in.get(id)) throw std::runtime_error("Truncated block frame.");
+    table = static_cast<uint8_t>(id);
+  }
+  return true;
+}
+
+void JcbFormat::writeIndex(std::ostream &out, const std::vector<SyncPoint> &points,
+                           uint64_t rawSize) {
+  std::string index;
+  for (const SyncPoint &point : points) {
+    putUint64(index, point.bitOffset);
+    putUint64(index, point.rawOffset);
+  }
+  putUint64(index, rawSize);
+  putUint32(index, static_cast<uint32_t>(points.size()));
+  index.append(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  out.write(index.data(), static_cast<std::streamsize>(index.size()));
+}
+
+/**
+ * @brief Reads the sync-point index at the end of a file
+ *
+ * @param in Seekable input stream
+ * @param points Receives the sync points, by increasing offsets
+ * @param rawSize Receives the uncompressed size of the data
+ * @return uint64_t Position of the index in the file, where the bit
+ *         stream ends
+ *
+ * @throws std::runtime_error If the index is missing or malformed
+ */
+uint64_t JcbFormat::readIndex(std::istream &in, std::vector<SyncPoint> &points,
+                              uint64_t &rawSize) {
+  auto invalid = [] { return std::runtime_error("Invalid sync-point index."); };
+
+  unsigned char footer[16];
+  if (not in.seekg(-static_cast<std::streamoff>(sizeof(footer)), std::ios::end) or
+      not in.read(reinterpret_cast<char *>(footer), sizeof(footer)) or
+      std::string(reinterpret_cast<char *>(footer) + 12, 4) != std::string(INDEX_MAGIC, 4)) {
+    throw invalid();
+  }
+  rawSize = getUint64(footer);
+  const uint64_t count = getUint32(footer + 8);
+
+  const std::streamoff size = 16 * static_cast<std::streamoff>(count);
+  if (not in.seekg(-static_cast<std::streamoff>(sizeof(footer)) - size, std::ios::end)) {
+    throw invalid();
+  }
+  const uint64_t position = static_cast<uint64_t>(in.tellg());
+
+  std::vector<unsigned char> entries(static_cast<size_t>(size));
+  if (not in.read(reinterpret_cast<char *>(entries.data()), size)) throw invalid();
+
+  points.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    points[i] = {getUint64(&entries[16 * i]), getUint64(&entries[16 * i + 8])};
+    if (points[i].rawOffset > rawSize or
+        (i > 0 and (points[i].bitOffset < points[i - 1].bitOffset or
+                    points[i].rawOffset < points[i - 1].rawOffset))) {
+      throw invalid();
+    }
+  }
+  return position;
+}
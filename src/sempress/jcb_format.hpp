@@ -0,0 +1,264 @@
+/**
+ * @file jcb_format.hpp
+ * @brief Definition of the JcbFormat class, which reads and writes the
+ * header of compressed (.jcb) files
+ */
+#pragma once
+#include "huffman_tree.hpp"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+/**
+ * @struct SyncPoint
+ * @brief Position where decoding can start in a single bit stream
+ */
+struct SyncPoint {
+  uint64_t bitOffset; ///< Offset of a code from the start of the bit stream
+  uint64_t rawOffset; ///< Number of decoded bytes before that code
+};
+
+/**
+ * @class JcbFormat
+ * @brief Utility class for the self-describing header of .jcb files
+ *
+ * Layout of the header (integers are little-endian):
+ * - magic: the 3 bytes "JCB"
+ * - version: 1 byte
+ * - flags: 1 byte, a combination of
+ *   - bit 0, FLAG_BLOCKS: independent block frames instead of one bit stream
+ *   - bit 1, FLAG_INDEX: a single bit stream followed by a sync-point index
+ *   - bit 2, FLAG_INTERLEAVED: 4 interleaved bit streams per block
+ *   - bit 3, FLAG_TABLES: several tables, each block naming its own
+ *   - bit 4, FLAG_DYNAMIC: codes rebuilt from the counts as the stream goes
+ *   - bits 5 to 7: reserved, zero
+ * - symbol count: 2 bytes
+ * - for each symbol, in canonical order:
+ *   - code length: 1 byte
+ *   - symbol length: 1 byte (0 for the end-of-file symbol)
+ *   - symbol bytes
+ *
+ * The encoded bit stream follows the header. Since the codes are
+ * canonical, the code lengths are enough to rebuild the code table.
+ *
+ * With FLAG_BLOCKS, the data is split into independent blocks instead of a
+ * single bit stream. Each block is framed by its uncompressed size and its
+ * compressed size (4 bytes each), followed by a bit stream ending with the
+ * end-of-file code. A frame with both sizes at zero ends the file. Reading
+ * the frames in order gives the index of every block, so blocks can be
+ * decoded concurrently.
+ *
+ * With FLAG_INTERLEAVED, the payload of each block holds 4 bit streams
+ * instead of one: token i of the block is in stream i % 4. The payload
+ * starts with the token count and the byte sizes of the first 3 streams
+ * (4 bytes each), followed by the byte-aligned streams, without
+ * end-of-file codes. A decoder keeps one bit reader per stream and decodes
+ * a token from each in turn, so the lookups of the 4 streams overlap.
+ *
+ * With FLAG_TABLES (only with FLAG_BLOCKS), the symbols of the first table
+ * are followed by the number of other tables (1 byte) and, for
+ * each of them, its symbol count and symbols as above. Every block frame
+ * then has a third field after its sizes: the id of the table its payload
+ * is encoded with (1 byte, 0 for the first table). The end frame has none.
+ *
+ * With FLAG_DYNAMIC, the symbols are followed by the rebuild interval (4
+ * bytes) and a single bit stream whose codes change as it goes: the header
+ * gives the initial code lengths, and encoder and decoder rebuild the
+ * codes from the symbol counts every interval symbols (see DynamicModel).
+ * It excludes the other flags.
+ *
+ * With FLAG_INDEX, a single bit stream is followed by a sync-point index:
+ * for every sync point, the offset in bits of a code in the bit stream and
+ * the number of decoded bytes before it (8 bytes each), then the
+ * uncompressed size (8 bytes), the sync-point count (4 bytes) and the
+ * magic "JCBX". Decoding can start at any sync point, so a byte range is
+ * decoded from the closest one. Block files need no index: their frames
+ * already give the offset of every block.
+ *
+ * The version stays 1 while sections are only added behind new flags: a
+ * file written without them has the layout of the first version, and a
+ * reader rejects the flags it does not know (KNOWN_FLAGS), so it never
+ * misreads a newer file. The version changes if the layout under existing
+ * flags does.
+ *
+ * All methods are static, so instantiation of the class is not required.
+ */
+class JcbFormat {
+public:
+  static constexpr uint8_t VERSION = 1; ///< Version written by this build
+
+  /// The data is a sequence of independent block frames
+  static constexpr uint8_t FLAG_BLOCKS = 1 << 0;
+
+  /// The single bit stream is followed by a sync-point index
+  static constexpr uint8_t FLAG_INDEX = 1 << 1;
+
+  /// Each block holds interleaved bit streams (with FLAG_BLOCKS)
+  static constexpr uint8_t FLAG_INTERLEAVED = 1 << 2;
+
+  /// Each block names the table it is encoded with (with FLAG_BLOCKS)
+  static constexpr uint8_t FLAG_TABLES = 1 << 3;
+
+  /// The codes are rebuilt from the symbol counts as the stream goes
+  static constexpr uint8_t FLAG_DYNAMIC = 1 << 4;
+
+  /// Flags understood by this build
+  static constexpr uint8_t KNOWN_FLAGS =
+      FLAG_BLOCKS | FLAG_INDEX | FLAG_INTERLEAVED | FLAG_TABLES | FLAG_DYNAMIC;
+
+  /// Largest number of tables a file may hold
+  static constexpr size_t MAX_TABLES = 256;
+
+  /// Largest uncompressed or compressed size of a block
+  static constexpr uint64_t MAX_BLOCK_SIZE = UINT32_MAX;
+
+  /**
+   * @brief Writes the header describing the codes of a tree
+   *
+   * @param out Output stream, positioned at the start of the file
+   * @param tree Huffman tree used to encode the data
+   * @param flags Layout flags of the data that follows
+   *
+   * @throws std::runtime_error If a symbol or a code does not fit the header
+   */
+  static void writeHeader(std::ostream &out, const HuffmanTree &tree,
+                          uint8_t flags = 0);
+
+  /**
+   * @brief Writes the header describing the codes of several trees
+   *
+   * FLAG_TABLES is added to the flags when there is more than one tree.
+   *
+   * @param out Output stream, positioned at the start of the file
+   * @param trees Huffman trees the blocks are encoded with, by table id
+   * @param flags Layout flags of the data that follows
+   *
+   * @throws std::runtime_error If there are too many trees, or if a symbol
+   *         or a code does not fit the header
+   */
+  static void writeHeader(std::ostream &out, const std::vector<HuffmanTree> &trees,
+                          uint8_t flags = 0);
+
+  /**
+   * @brief Reads a header and rebuilds the codes it describes
+   *
+   * @param in Input stream, positioned at the start of the file
+   * @param flags Receives the layout flags of the data that follows
+   * @return HuffmanTree Tree rebuilt from the code lengths (no nodes)
+   *
+   * @throws std::runtime_error If the header is missing or malformed
+   */
+  static HuffmanTree readHeader(std::istream &in, uint8_t &flags);
+
+  /**
+   * @brief Reads a header and rebuilds the codes of all its tables
+   *
+   * @param in Input stream, positioned at the start of the file
+   * @param flags Receives the layout flags of the data that follows
+   * @return std::vector<HuffmanTree> Trees rebuilt from the code lengths
+   *         (no nodes), by table id; a single one without FLAG_TABLES
+   *
+   * @throws std::runtime_error If the header is missing or malformed
+   */
+  static std::vector<HuffmanTree> readTables(std::istream &in, uint8_t &flags);
+
+  /**
+   * @brief Writes the rebuild interval, after a header with FLAG_DYNAMIC
+   *
+   * @param out Output stream
+   * @param interval Symbols between two rebuilds of the codes
+   */
+  static void writeRebuildInterval(std::ostream &out, uint32_t interval);
+
+  /**
+   * @brief Reads the rebuild interval, after a header with FLAG_DYNAMIC
+   *
+   * @param in Input stream, positioned after the symbols
+   * @return uint32_t Symbols between two rebuilds of the codes
+   *
+   * @throws std::runtime_error If the interval is missing or zero
+   */
+  static uint32_t readRebuildInterval(std::istream &in);
+
+  /**
+   * @brief Writes one block frame
+   *
+   * @param out Output stream
+   * @param flags Layout flags of the file
+   * @param rawSize Uncompressed size of the block
+   * @param payload Encoded bit stream of the block
+   * @param table Id of the table of the block (written with FLAG_TABLES)
+   *
+   * @throws std::runtime_error If a size does not fit the frame
+   */
+  static void writeBlock(std::ostream &out, uint8_t flags, uint64_t rawSize,
+                         const std::vector<unsigned char> &payload,
+                         uint8_t table = 0);
+
+  /**
+   * @brief Writes the frame that ends a block sequence
+   *
+   * @param out Output stream
+   */
+  static void writeEnd(std::ostream &out);
+
+  /**
+   * @brief Reads the next block frame
+   *
+   * @param in Input stream, positioned at a frame
+   * @param flags Layout flags of the file
+   * @param rawSize Receives the uncompressed size of the block
+   * @param payload Receives the encoded bit stream of the block
+   * @param table Receives the id of the table of the block (0 without
+   *        FLAG_TABLES)
+   * @return true if a block was read, false at the end frame
+   *
+   * @throws std::runtime_error If the frame is truncated
+   */
+  static bool readBlock(std::istream &in, uint8_t flags, uint64_t &rawSize,
+                        std::vector<unsigned char> &payload, uint8_t &table);
+
+  /**
+   * @brief Reads the sizes of the next block frame, leaving the stream at
+   * its payload
+   *
+   * Lets a reader skip a block with a seek instead of reading it.
+   *
+   * @param in Input stream, positioned at a frame
+   * @param flags Layout flags of the file
+   * @param rawSize Receives the uncompressed size of the block
+   * @param payloadSize Receives the size of the encoded bit stream
+   * @param table Receives the id of the table of the block (0 without
+   *        FLAG_TABLES)
+   * @return true if a block follows, false at the end frame
+   *
+   * @throws std::runtime_error If the frame is truncated
+   */
+  static bool readFrame(std::istream &in, uint8_t flags, uint64_t &rawSize,
+                        uint64_t &payloadSize, uint8_t &table);
+
+  /**
+   * @brief Writes the sync-point index, after the padded bit stream
+   *
+   * @param out Output stream
+   * @param points Sync points, by increasing offsets
+   * @param rawSize Uncompressed size of the data
+   */
+  static void writeIndex(std::ostream &out, const std::vector<SyncPoint> &points,
+                         uint64_t rawSize);
+
+  /**
+   * @brief Reads the sync-point index at the end of a file
+   *
+   * @param in Seekable input stream
+   * @param points Receives the sync points, by increasing offsets
+   * @param rawSize Receives the uncompressed size of the data
+   * @return uint64_t Position of the index in the file, where the bit
+   *         stream ends
+   *
+   * @throws std::runtime_error If the index is missing or malformed
+   */
+  static uint64_t readIndex(std::istream &in, std::vector<SyncPoint> &points,
+                            uint64_t &rawSize);
+};
@@ -1,10 +1,30 @@
 /**
  * @file main.cpp
  * @brief Main program for file compression using Huffman Algorithm
+ *
+ * The CLI reads and writes .jcb files, so it drives Compressor and
+ * Decompressor rather than Codec: a .jcb file carries its codes, blocks,
+ * index and dynamic rebuilds, and is streamed or mapped instead of held
+ * in memory, none of which a Codec buffer has. Both share the table
+ * loading (Codec::loadTable) and the token parsers.
  */
 #include "compressor.hpp"
 #include "decompressor.hpp"
+#include "stats.hpp"
+#include "stream_io.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
+
+/// Block size used when -j is given without --block-size
+static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+/// Rebuild interval used when --dynamic is given without --rebuild-interval
+static constexpr unsigned DEFAULT_REBUILD_INTERVAL = 4096;
 
 /**
  * @brief Main program function for compression
@@ -21,37 +41,255 @@
 
 void usage(char *argv[]) {
   std::cerr << "Usage:\n"
-            << "  " << argv[0]
-            << " <frequency_table> <input_file> <output_file> [-d : decompress]\n";
+            << "  " << argv[0] << " [options] <frequency_table> <input_file> <output_file>\n"
+            << "  " << argv[0] << " [options] --adaptive [frequency_table] <input_file> <output_file>\n"
+            << "  " << argv[0] << " [options] --dynamic [frequency_table] <input_file> <output_file>\n"
+            << "  " << argv[0] << " [options] --tables <table,table,...> <input_file> <output_file>\n"
+            << "  " << argv[0] << " [options] [frequency_table] <input_file> <output_file> -d : decompress\n"
+            << "  " << argv[0] << " --batch [-j threads] [--dynamic] <frequency_table> <directory|file_list|->\n"
+            << "  " << argv[0] << " compile-table [--max-code-length <bits>] <frequency_table> <compiled_table>\n"
+            << "Options:\n"
+            << "  -j <threads>         Compress/decompress independent blocks in parallel (0: all cores)\n"
+            << "  --block-size <size>  Block size for -j, in bytes or with a K/M suffix (default 1M)\n"
+            << "  --tables <list>      Comma-separated tables; each block is encoded with the one estimated\n"
+            << "                       to give the smallest output (implies block mode, up to 256 tables)\n"
+            << "  --interleave         Split each block into 4 interleaved bit streams, decoded together\n"
+            << "  --max-code-length <bits> Limit the codes built from a text table to <bits> bits\n"
+            << "  --index <size>       Write a sync-point index every <size> input bytes (single-stream files)\n"
+            << "  --adaptive           Count the input first and build the codes from it; the table, if\n"
+            << "                       given, only proposes multi-character symbols (input must be a file)\n"
+            << "  --dynamic            Single pass with codes rebuilt from the counts of the data seen so\n"
+            << "                       far; the table, if given, gives the initial codes (live input is\n"
+            << "                       encoded and decoded as it arrives)\n"
+            << "  --rebuild-interval <n> Symbols between two rebuilds of the codes (implies --dynamic,\n"
+            << "                       default 4096)\n"
+            << "  --best               Choose the tokens that encode to the fewest bits (slower, smaller output)\n"
+            << "  --range <start>:<end> With -d, write only the decoded bytes from start up to end\n"
+            << "                       (exclusive; an empty end means the end of the data)\n"
+            << "  --batch              Compress every file of a directory, of a list file or of a list\n"
+            << "                       read from stdin (-), each into <file>.jcb, loading the table once\n"
+            << "  --stats[=json]       Write byte and token counts, phase times and the code-length\n"
+            << "                       histogram to stderr when done, as text or as a JSON object\n"
+            << "The frequency table is not needed to decompress: the codes are stored in the compressed file.\n"
+            << "A compiled table can be used anywhere a frequency table is expected, and loads faster.\n"
+            << "Use - as input or output file to read from stdin or write to stdout.\n";
   std::exit(1);
 }
 
+/**
+ * @brief Parses a size given in bytes or with a K/M suffix
+ *
+ * @param text Size given by the user, e.g. "4096", "64K" or "1M"
+ * @return size_t Size in bytes
+ * @throws std::invalid_argument If the text is not a size
+ */
+size_t parseSize(const std::string &text) {
+  size_t used;
+  unsigned long long value = std::stoull(text, &used);
+  std::string suffix = text.substr(used);
+  if (suffix == "K" or suffix == "k") return value << 10;
+  if (suffix == "M" or suffix == "m") return value << 20;
+  if (not suffix.empty()) throw std::invalid_argument("invalid size: " + text);
+  return value;
+}
+
+/**
+ * @brief Writes the statistics of the run to stderr
+ *
+ * @param json Writes a JSON object instead of text
+ */
+void reportStats(bool json) {
+  if (not Stats::ENABLED) {
+    std::cerr << "Statistics were compiled out; build with STATS=1 to get them.\n";
+    return;
+  }
+  Stats::report(std::cerr, json);
+}
+
+/**
+ * @brief Lists the files of a batch
+ *
+ * A directory gives its regular files, recursively and sorted, except the
+ * .jcb files a previous batch wrote. A file or stdin ("-") gives one path
+ * per line.
+ *
+ * @param source Directory, list file or "-"
+ * @return std::vector<std::string> Paths of the files to compress
+ * @throws std::runtime_error If the source cannot be read
+ */
+std::vector<std::string> listBatch(const std::string &source) {
+  namespace fs = std::filesystem;
+  std::vector<std::string> files;
+
+  if (not StreamIO::isStandard(source) and fs::is_directory(source)) {
+    for (const auto &entry : fs::recursive_directory_iterator(source)) {
+      if (entry.is_regular_file() and entry.path().extension() != ".jcb") {
+        files.push_back(entry.path().string());
+      }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+  }
+
+  std::ifstream listFile;
+  std::istream &list = StreamIO::openInput(source, listFile);
+  std::string line;
+  while (std::getline(list, line)) {
+    if (not line.empty() and line.back() == '\r') line.pop_back();
+    if (not line.empty()) files.push_back(line);
+  }
+  return files;
+}
+
 int main(int argc, char *argv[]) {
+  // Lets stdin report the bytes it holds, so live input is not waited for
+  std::ios::sync_with_stdio(false);
+
   try {
-    // Check minimum number of arguments
-    if (argc < 4) {
-      usage(argv);
+    if (argc > 1 and std::string(argv[1]) == "compile-table") {
+      unsigned maxCodeLength = 0;
+      int first = 2;
+      if (argc == 6 and std::string(argv[2]) == "--max-code-length") {
+        maxCodeLength = static_cast<unsigned>(std::stoul(argv[3]));
+        first = 4;
+      }
+      if (argc != first + 2) usage(argv);
+      Compressor compressor;
+      compressor.compileTable(argv[first], argv[first + 1], maxCodeLength);
+      std::cout << "Compiled table created in file \"" << argv[first + 1] << "\"\n";
+      return 0;
     }
 
-    std::string tablePath = argv[1];
-    std::string inputFile = argv[2];
-    std::string outputFile = argv[3];
-  
-    if(argc == 4) { 
-      Compressor compressor;
-      std::cout << "Starting compression...\n";
-      compressor.compress(inputFile, outputFile, tablePath);
-    } else {
-      std::string flag = argv[4];
-      if (flag != "-d") {
+    CompressOptions compressOptions;
+    DecompressOptions decompressOptions;
+    bool decompress = false;
+    bool blocks = false;
+    bool batch = false;
+    bool range = false;
+    bool stats = false, statsJson = false;
+    uint64_t rangeStart = 0, rangeEnd = UINT64_MAX;
+    std::vector<std::string> paths;
+    std::vector<std::string> tablePaths;
+
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "-d") {
+        decompress = true;
+      } else if (arg == "--adaptive") {
+        compressOptions.adaptive = true;
+      } else if (arg == "--dynamic") {
+        if (compressOptions.rebuildInterval == 0) {
+          compressOptions.rebuildInterval = DEFAULT_REBUILD_INTERVAL;
+        }
+      } else if (arg == "--rebuild-interval" and i + 1 < argc) {
+        compressOptions.rebuildInterval = static_cast<unsigned>(std::stoul(argv[++i]));
+        if (compressOptions.rebuildInterval == 0) usage(argv);
+      } else if (arg == "--best") {
+        compressOptions.optimalParse = true;
+      } else if (arg == "--max-code-length" and i + 1 < argc) {
+        compressOptions.maxCodeLength = static_cast<unsigned>(std::stoul(argv[++i]));
+        if (compressOptions.maxCodeLength == 0) usage(argv);
+      } else if (arg == "--tables" and i + 1 < argc) {
+        std::string list = argv[++i];
+        for (size_t from = 0, comma; from <= list.size(); from = comma + 1) {
+          comma = std::min(list.find(',', from), list.size());
+          if (comma > from) tablePaths.push_back(list.substr(from, comma - from));
+        }
+        if (tablePaths.empty()) usage(argv);
+        blocks = true;
+      } else if (arg == "--interleave") {
+        compressOptions.interleave = true;
+        blocks = true;
+      } else if (arg == "--index" and i + 1 < argc) {
+        compressOptions.indexInterval = parseSize(argv[++i]);
+        if (compressOptions.indexInterval == 0) usage(argv);
+      } else if (arg == "--range" and i + 1 < argc) {
+        std::string bounds = argv[++i];
+        size_t colon = bounds.find(':');
+        if (colon == std::string::npos) usage(argv);
+        rangeStart = parseSize(bounds.substr(0, colon));
+        if (colon + 1 < bounds.size()) rangeEnd = parseSize(bounds.substr(colon + 1));
+        range = true;
+      } else if (arg == "--batch") {
+        batch = true;
+      } else if (arg == "--stats" or arg == "--stats=text" or arg == "--stats=json") {
+        stats = true;
+        statsJson = arg == "--stats=json";
+      } else if (arg == "-j" and i + 1 < argc) {
+        unsigned threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        compressOptions.threads = decompressOptions.threads = threads;
+        blocks = true;
+      } else if (arg == "--block-size" and i + 1 < argc) {
+        compressOptions.blockSize = parseSize(argv[++i]);
+        blocks = true;
+        if (compressOptions.blockSize == 0) usage(argv);
+      } else {
+        paths.push_back(arg);
+      }
+    }
+
+    // A byte range only applies to decompression
+    if (range and not decompress) usage(argv);
+
+    if (batch) {
+      // Dynamic codes need no table
+      const size_t minPaths = compressOptions.rebuildInterval > 0 ? 1 : 2;
+      if (decompress or not tablePaths.empty() or paths.size() < minPaths or paths.size() > 2) {
         usage(argv);
       }
+
+      std::vector<std::string> files = listBatch(paths.back());
+      const std::string tablePath = paths.size() == 2 ? paths[0] : "";
+      Compressor compressor;
+      std::cout << "Compressing " << files.size() << " files...\n";
+      size_t failed = 0;
+      for (const BatchResult &result : compressor.compressBatch(files, tablePath, compressOptions)) {
+        if (not result.error.empty()) {
+          std::cerr << "Error: " << result.inputFile << ": " << result.error << "\n";
+          failed++;
+        }
+      }
+      std::cout << "Compressed " << files.size() - failed << " of " << files.size() << " files.\n";
+      if (stats) reportStats(statsJson);
+      return failed == 0 ? 0 : 1;
+    }
+
+    // The table, if given, is accepted for compatibility and ignored by -d,
+    // and optional in adaptive and dynamic modes; --tables replaces it
+    const bool optionalTable =
+        decompress or compressOptions.adaptive or compressOptions.rebuildInterval > 0;
+    if (not tablePaths.empty()) {
+      if (decompress or paths.size() != 2) usage(argv);
+    } else if (optionalTable ? paths.size() < 2 or paths.size() > 3 : paths.size() != 3) {
+      usage(argv);
+    }
+    if (paths.size() == 3) tablePaths.push_back(paths[0]);
+    std::string inputFile = paths[paths.size() - 2];
+    std::string outputFile = paths[paths.size() - 1];
+
+    // Progress messages must not mix with data written to stdout
+    std::ostream &log = StreamIO::isStandard(outputFile) ? std::cerr : std::cout;
+
+    if (decompress) {
       Decompressor decompressor;
-      std::cout << "Starting decompression...\n";
-      decompressor.decompress(inputFile, outputFile, tablePath);
+      log << "Starting decompression...\n";
+      if (range) {
+        decompressor.decompressRange(inputFile, outputFile, rangeStart, rangeEnd);
+      } else {
+        decompressor.decompress(inputFile, outputFile, decompressOptions);
+      }
+    } else {
+      if (blocks and compressOptions.blockSize == 0) {
+        compressOptions.blockSize = DEFAULT_BLOCK_SIZE;
+      }
+      Compressor compressor;
+      log << "Starting compression...\n";
+      compressor.compress(inputFile, outputFile, tablePaths, compressOptions);
+      log << "Compression completed. Output: " << outputFile << "\n";
     }
 
-    std::cout << "Operation completed successfully.\n";
+    log << "Operation completed successfully.\n";
+    if (stats) reportStats(statsJson);
 
   } catch (const std::exception &e) {
     std::cerr << "Error: " << e.what() << std::endl;
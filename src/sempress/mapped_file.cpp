@@ -0,0 +1,65 @@
+/**
+ * @file mapped_file.cpp
+ * @brief Implementation of the read-only file mapping
+ */
+#include "mapped_file.hpp"
+#include "stream_io.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <utility>
+
+MappedFile::MappedFile(const std::string &path) {
+  if (StreamIO::isStandard(path)) return;
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return;
+
+  // Only non-empty regular files can be mapped; pipes and devices are read
+  struct stat info;
+  if (::fstat(fd, &info) == 0 and S_ISREG(info.st_mode) and info.st_size > 0) {
+    void *mapping = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                           MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      address = mapping;
+      length = static_cast<size_t>(info.st_size);
+      ::madvise(address, length, MADV_SEQUENTIAL);
+    }
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+}
+
+void MappedFile::release(size_t end) {
+  if (not address) return;
+
+  // Only whole pages can be dropped
+  const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  end = std::min(end, length) / page * page;
+  if (end <= released) return;
+
+  ::madvise(static_cast<char *>(address) + released, end - released, MADV_DONTNEED);
+  released = end;
+}
+
+MappedFile::~MappedFile() {
+  if (address) ::munmap(address, length);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : address(std::exchange(other.address, nullptr)),
+      length(std::exchange(other.length, 0)),
+      released(std::exchange(other.released, 0)) {}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    if (address) ::munmap(address, length);
+    address = std::exchange(other.address, nullptr);
+    length = std::exchange(other.length, 0);
+    released = std::exchange(other.released, 0);
+  }
+  return *this;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file mapped_file.hpp
+ * @brief Definition of the MappedFile class, a read-only memory mapping of
+ * an input file
+ */
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @class MappedFile
+ * @brief Maps a regular file into memory for zero-copy reads
+ *
+ * The mapping is advised as sequential, so the kernel reads ahead and
+ * drops the pages behind the reader early. Anything that cannot be mapped
+ * (stdin, pipes, empty or special files) leaves the object unmapped
+ * without an error, and the caller falls back to buffered stream reads.
+ */
+class MappedFile {
+public:
+  /**
+   * @brief Default constructor - creates an unmapped file
+   */
+  MappedFile() = default;
+
+  /**
+   * @brief Maps a file if possible
+   *
+   * @param path Path to the file ("-" is never mapped)
+   */
+  explicit MappedFile(const std::string &path);
+
+  /**
+   * @brief Unmaps the file
+   */
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  /**
+   * @brief Checks if the file was mapped
+   *
+   * @return true if view() holds the contents of the file
+   */
+  bool isMapped() const { return address != nullptr; }
+
+  /**
+   * @brief Returns the contents of the mapped file
+   *
+   * @return std::string_view Bytes of the file, valid while the object lives
+   */
+  std::string_view view() const {
+    return {static_cast<const char *>(address), length};
+  }
+
+  /**
+   * @brief Drops the pages before an offset from the process
+   *
+   * Keeps the resident size of a long sequential read bounded; the bytes
+   * are read back from the file if accessed again.
+   *
+   * @param end Offset up to which the contents are no longer needed
+   */
+  void release(size_t end);
+
+private:
+  void *address = nullptr; ///< Start of the mapping, null if unmapped
+  size_t length = 0;       ///< Size of the mapping
+  size_t released = 0;     ///< Bytes at the front already released
+};
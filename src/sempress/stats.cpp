@@ -0,0 +1,164 @@
+/**
+ * @file stats.cpp
+ * @brief Implementation of the counters and phase timers reported by --stats
+ */
+#include "stats.hpp"
+
+#if SEMPRESS_STATS
+#include "huffman_tree.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+
+/// Names of the phases, in the order of Stats::Phase
+static const char *const PHASE_NAMES[Stats::PHASE_COUNT] = {
+    "table_load", "tree_build", "count", "encode", "decode", "io"};
+
+/**
+ * @brief Returns the totals of the threads that have exited
+ *
+ * Never destroyed, so threads exiting late still find them.
+ *
+ * @return std::pair<std::mutex, Stats::Counters>& Lock and totals
+ */
+static std::pair<std::mutex, Stats::Counters> &shared() {
+  static auto *totals = new std::pair<std::mutex, Stats::Counters>();
+  return *totals;
+}
+
+/**
+ * @struct ThreadCounters
+ * @brief Counters of one thread, added to the totals when it exits
+ */
+struct ThreadCounters {
+  Stats::Counters counters;
+
+  ~ThreadCounters() {
+    auto &[lock, totals] = shared();
+    std::lock_guard<std::mutex> guard(lock);
+    totals.add(counters);
+  }
+};
+
+static thread_local ThreadCounters threadCounters;
+
+thread_local Stats::PhaseTimer *Stats::PhaseTimer::active = nullptr;
+
+void Stats::Counters::codes(const std::vector<HuffmanCode> &codes) {
+  for (const HuffmanCode &code : codes) {
+    codeLengths[std::min<unsigned>(code.length, MAX_CODE_LENGTH)]++;
+  }
+}
+
+void Stats::Counters::add(const Counters &other) {
+  bytesIn += other.bytesIn;
+  bytesOut += other.bytesOut;
+  multiCharTokens += other.multiCharTokens;
+  singleCharTokens += other.singleCharTokens;
+  droppedBytes += other.droppedBytes;
+  for (size_t i = 0; i < codeLengths.size(); i++) codeLengths[i] += other.codeLengths[i];
+  for (size_t i = 0; i < seconds.size(); i++) seconds[i] += other.seconds[i];
+}
+
+/**
+ * @brief Starts timing a phase, pausing the timer it is nested in
+ *
+ * @param phase Phase the time goes to
+ */
+Stats::PhaseTimer::PhaseTimer(Phase phase)
+    : phase(phase), start(Clock::now()), outer(active) {
+  if (outer) {
+    threadCounters.counters.seconds[outer->phase] +=
+        std::chrono::duration<double>(start - outer->start).count();
+  }
+  active = this;
+}
+
+/**
+ * @brief Adds the time of the phase and resumes the outer timer
+ */
+Stats::PhaseTimer::~PhaseTimer() {
+  const Clock::time_point now = Clock::now();
+  threadCounters.counters.seconds[phase] += std::chrono::duration<double>(now - start).count();
+  if (outer) outer->start = now;
+  active = outer;
+}
+
+Stats::Counters &Stats::local() { return threadCounters.counters; }
+
+Stats::Counters Stats::totals() {
+  auto &[lock, shared_totals] = shared();
+  std::lock_guard<std::mutex> guard(lock);
+  Counters totals = shared_totals;
+  totals.add(threadCounters.counters);
+  return totals;
+}
+
+/**
+ * @brief Writes the totals so far
+ *
+ * The text form gives the ratio and the share of multi-character tokens
+ * as well; the JSON form leaves them to the reader. Phases that took no
+ * time and empty histogram bins are left out of both.
+ *
+ * @param out Output stream
+ * @param json Writes a JSON object instead of text
+ */
+void Stats::report(std::ostream &out, bool json) {
+  const Counters totals = Stats::totals();
+  const uint64_t tokens = totals.multiCharTokens + totals.singleCharTokens;
+
+  if (json) {
+    out << "{\"bytes_in\": " << totals.bytesIn << ", \"bytes_out\": " << totals.bytesOut
+        << ", \"multi_char_tokens\": " << totals.multiCharTokens
+        << ", \"single_char_tokens\": " << totals.singleCharTokens
+        << ", \"dropped_bytes\": " << totals.droppedBytes << ", \"seconds\": {";
+    const char *separator = "";
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+      if (totals.seconds[i] == 0) continue;
+      out << separator << "\"" << PHASE_NAMES[i] << "\": " << std::fixed
+          << std::setprecision(6) << totals.seconds[i];
+      separator = ", ";
+    }
+    out << "}, \"code_lengths\": {";
+    separator = "";
+    for (size_t length = 0; length <= MAX_CODE_LENGTH; length++) {
+      if (totals.codeLengths[length] == 0) continue;
+      out << separator << "\"" << length << "\": " << totals.codeLengths[length];
+      separator = ", ";
+    }
+    out << "}}\n";
+    return;
+  }
+
+  out << "Statistics:\n"
+      << "  Bytes in:       " << totals.bytesIn << "\n"
+      << "  Bytes out:      " << totals.bytesOut;
+  if (totals.bytesIn > 0 and totals.bytesOut > 0) {
+    out << " (ratio " << std::fixed << std::setprecision(4)
+        << static_cast<double>(totals.bytesOut) / static_cast<double>(totals.bytesIn) << ")";
+  }
+  out << "\n";
+  if (tokens > 0) {
+    out << "  Tokens:         " << tokens << " (" << std::fixed << std::setprecision(1)
+        << 100.0 * static_cast<double>(totals.multiCharTokens) / static_cast<double>(tokens)
+        << "% multi-character)\n";
+  }
+  out << "  Dropped bytes:  " << totals.droppedBytes << "\n";
+  for (size_t i = 0; i < PHASE_COUNT; i++) {
+    if (totals.seconds[i] == 0) continue;
+    out << "  Time " << std::left << std::setw(12) << PHASE_NAMES[i] << std::right
+        << std::fixed << std::setprecision(3) << totals.seconds[i] * 1000 << " ms\n";
+  }
+  if (std::any_of(totals.codeLengths.begin(), totals.codeLengths.end(),
+                  [](uint64_t count) { return count > 0; })) {
+    out << "  Code lengths:  ";
+    for (size_t length = 0; length <= MAX_CODE_LENGTH; length++) {
+      if (totals.codeLengths[length] == 0) continue;
+      out << " " << length << (length == MAX_CODE_LENGTH ? "+" : "") << ":"
+          << totals.codeLengths[length];
+    }
+    out << "\n";
+  }
+}
+#endif
@@ -0,0 +1,181 @@
+/**
+ * @file stats.hpp
+ * @brief Definition of the Stats class, which counts what the hot paths do
+ * and times their phases for --stats
+ */
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/// Set to 0 (make STATS=0) to compile the counters and timers out; every
+/// object of a program must be built with the same value
+#ifndef SEMPRESS_STATS
+#define SEMPRESS_STATS 1
+#endif
+
+struct HuffmanCode;
+
+/**
+ * @class Stats
+ * @brief Counters and phase timers of the compressor, the decompressor and
+ * the frequency counter
+ *
+ * Each thread counts into its own Counters, so the hot loops never share
+ * a cache line; they are added to the totals when the thread exits, or
+ * when the totals are read from it. Phase timers nest: while an inner
+ * phase runs, the outer one is paused, so each second is counted once.
+ *
+ * Built with SEMPRESS_STATS set to 0, Counters and PhaseTimer are empty
+ * and their members do nothing, so the calls compile to nothing.
+ */
+class Stats {
+public:
+  /// Whether the counters are compiled in
+  static constexpr bool ENABLED = SEMPRESS_STATS != 0;
+
+  /// Phases timed separately
+  enum Phase {
+    TABLE_LOAD, ///< Reading a table or the header of a compressed file
+    TREE_BUILD, ///< Computing code lengths, codes and decoding tables
+    COUNT,      ///< Counting symbols into a frequency table
+    ENCODE,     ///< Matching tokens and writing their codes
+    DECODE,     ///< Reading codes and writing their symbols
+    IO,         ///< Reading and writing streams
+    PHASE_COUNT
+  };
+
+  /// Codes of this length or more share the last bin of the histogram
+  static constexpr unsigned MAX_CODE_LENGTH = 64;
+
+#if SEMPRESS_STATS
+  /**
+   * @struct Counters
+   * @brief What one thread, or the whole run, did
+   */
+  struct Counters {
+    uint64_t bytesIn = 0;          ///< Bytes read (input or compressed file)
+    uint64_t bytesOut = 0;         ///< Bytes written
+    uint64_t multiCharTokens = 0;  ///< Tokens matching a keyword
+    uint64_t singleCharTokens = 0; ///< Tokens of a single character
+    uint64_t droppedBytes = 0;     ///< Bytes without a code, left out
+    std::array<uint64_t, MAX_CODE_LENGTH + 1> codeLengths{}; ///< Codes by length
+    std::array<double, PHASE_COUNT> seconds{};               ///< Time by phase
+
+    /**
+     * @brief Counts bytes read
+     *
+     * @param bytes Bytes read
+     */
+    void read(uint64_t bytes) { bytesIn += bytes; }
+
+    /**
+     * @brief Counts bytes written
+     *
+     * @param bytes Bytes written
+     */
+    void written(uint64_t bytes) { bytesOut += bytes; }
+
+    /**
+     * @brief Counts matched tokens
+     *
+     * @param length Bytes covered by the token
+     * @param count Number of tokens of that length
+     */
+    void token(size_t length, uint64_t count = 1) {
+      multiCharTokens += length > 1 ? count : 0;
+      singleCharTokens += length > 1 ? 0 : count;
+    }
+
+    /**
+     * @brief Counts a byte that has no code
+     */
+    void dropped() { droppedBytes++; }
+
+    /**
+     * @brief Counts the codes of a table in the code-length histogram
+     *
+     * @param codes Codes by symbol id
+     */
+    void codes(const std::vector<HuffmanCode> &codes);
+
+    /**
+     * @brief Adds the counts of another thread or run
+     *
+     * @param other Counters to add
+     */
+    void add(const Counters &other);
+  };
+
+  /**
+   * @class PhaseTimer
+   * @brief Adds the time between its construction and destruction to a
+   * phase, except the time of the timers nested in it
+   */
+  class PhaseTimer {
+  public:
+    explicit PhaseTimer(Phase phase);
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    Phase phase;             ///< Phase the time goes to
+    Clock::time_point start; ///< Start of the running stretch
+    PhaseTimer *outer;       ///< Timer paused by this one, if any
+
+    static thread_local PhaseTimer *active; ///< Innermost running timer
+  };
+
+  /**
+   * @brief Returns the counters of the calling thread
+   *
+   * Hot loops take the reference once, outside the loop.
+   *
+   * @return Counters& Counters of the thread
+   */
+  static Counters &local();
+
+  /**
+   * @brief Returns the totals of the threads that have exited and of the
+   * calling thread
+   *
+   * @return Counters Totals so far
+   */
+  static Counters totals();
+
+  /**
+   * @brief Writes the totals so far
+   *
+   * @param out Output stream
+   * @param json Writes a JSON object instead of text
+   */
+  static void report(std::ostream &out, bool json);
+#else
+  struct Counters {
+    void read(uint64_t) {}
+    void written(uint64_t) {}
+    void token(size_t, uint64_t = 1) {}
+    void dropped() {}
+    void codes(const std::vector<HuffmanCode> &) {}
+  };
+
+  class PhaseTimer {
+  public:
+    explicit PhaseTimer(Phase) {}
+  };
+
+  static Counters &local() {
+    static Counters counters;
+    return counters;
+  }
+
+  static void report(std::ostream &, bool) {}
+#endif
+};
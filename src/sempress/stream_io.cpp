@@ -0,0 +1,22 @@
+/**
+ * @file stream_io.cpp
+ * @brief Implementation of the file and standard stream helpers
+ */
+#include "stream_io.hpp"
+#include <stdexcept>
+
+std::istream &StreamIO::openInput(const std::string &path, std::ifstream &file) {
+  if (isStandard(path)) return std::cin;
+
+  file.open(path, std::ios::binary);
+  if (not file.is_open()) throw std::runtime_error("Error opening " + path + ".");
+  return file;
+}
+
+std::ostream &StreamIO::openOutput(const std::string &path, std::ofstream &file) {
+  if (isStandard(path)) return std::cout;
+
+  file.open(path, std::ios::binary);
+  if (not file.is_open()) throw std::runtime_error("Error opening " + path + ".");
+  return file;
+}
@@ -0,0 +1,51 @@
+/**
+ * @file stream_io.hpp
+ * @brief Definition of the StreamIO class, which opens files or the
+ * standard streams for the command line tools
+ */
+#pragma once
+#include <fstream>
+#include <iostream>
+#include <string>
+
+/**
+ * @class StreamIO
+ * @brief Utility class mapping paths to binary streams
+ *
+ * The path "-" stands for the standard input or output, so the tools can
+ * run inside shell pipelines. All methods are static, so instantiation of
+ * the class is not required for use.
+ */
+class StreamIO {
+public:
+  /// Path standing for the standard input or output
+  static constexpr const char *STANDARD = "-";
+
+  /**
+   * @brief Checks if a path stands for a standard stream
+   *
+   * @param path Path given by the user
+   * @return true if the path is "-"
+   */
+  static bool isStandard(const std::string &path) { return path == STANDARD; }
+
+  /**
+   * @brief Opens a path for binary reading
+   *
+   * @param path Path of the file, or "-" for the standard input
+   * @param file Stream that will hold the opened file
+   * @return std::istream& The opened file, or std::cin
+   * @throws std::runtime_error If the file cannot be opened
+   */
+  static std::istream &openInput(const std::string &path, std::ifstream &file);
+
+  /**
+   * @brief Opens a path for binary writing
+   *
+   * @param path Path of the file, or "-" for the standard output
+   * @param file Stream that will hold the opened file
+   * @return std::ostream& The opened file, or std::cout
+   * @throws std::runtime_error If the file cannot be opened
+   */
+  static std::ostream &openOutput(const std::string &path, std::ofstream &file);
+};
@@ -0,0 +1,76 @@
+/**
+ * @file table_selector.cpp
+ * @brief Implementation of the per-block table selection
+ */
+#include "table_selector.hpp"
+#include "byte_histogram.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+TableSelector::TableSelector(const std::vector<HuffmanTree> &trees)
+    : tableCount(trees.size()) {
+  const size_t groups = (tableCount + LANES - 1) / LANES;
+  costs.assign(groups * 256 * LANES, MISSING_COST);
+
+  for (size_t table = 0; table < tableCount; table++) {
+    double *group = &costs[(table / LANES) * 256 * LANES];
+    const std::vector<std::string> &symbols = trees[table].getSymbols();
+    const std::vector<HuffmanCode> &codes = trees[table].getCodes();
+
+    // A symbol of code length L occurs about 2^-L of the time; each of its
+    // bytes is charged L / size bits
+    double weights[256] = {}, bits[256] = {};
+    bool single[256] = {};
+    for (size_t id = 0; id < symbols.size(); id++) {
+      const std::string &symbol = symbols[id];
+      if (symbol.empty()) continue;
+      const double weight = std::ldexp(1.0, -static_cast<int>(codes[id].length));
+      for (char c : symbol) {
+        const auto byte = static_cast<unsigned char>(c);
+        weights[byte] += weight;
+        bits[byte] += weight * codes[id].length / static_cast<double>(symbol.size());
+      }
+      if (symbol.size() == 1) single[static_cast<unsigned char>(symbol[0])] = true;
+    }
+    for (unsigned byte = 0; byte < 256; byte++) {
+      if (single[byte]) group[byte * LANES + table % LANES] = bits[byte] / weights[byte];
+    }
+  }
+}
+
+/**
+ * @brief Returns the table estimated to encode a block in fewest bits
+ *
+ * @param block Uncompressed bytes of the block
+ * @return size_t Table id; ties go to the lowest id
+ */
+size_t TableSelector::select(std::string_view block) const {
+  if (tableCount < 2) return 0;
+
+  uint64_t counts[256] = {};
+  ByteHistogram::count(reinterpret_cast<const unsigned char *>(block.data()), block.size(), counts);
+
+  double histogram[256];
+  for (unsigned byte = 0; byte < 256; byte++) histogram[byte] = static_cast<double>(counts[byte]);
+
+  size_t best = 0;
+  double bestBits = std::numeric_limits<double>::infinity();
+  for (size_t first = 0; first < tableCount; first += LANES) {
+    const double *group = &costs[(first / LANES) * 256 * LANES];
+    double bits[LANES] = {};
+    for (unsigned byte = 0; byte < 256; byte++) {
+      for (unsigned lane = 0; lane < LANES; lane++) {
+        bits[lane] += histogram[byte] * group[byte * LANES + lane];
+      }
+    }
+
+    for (unsigned lane = 0; lane < LANES and first + lane < tableCount; lane++) {
+      if (bits[lane] < bestBits) {
+        bestBits = bits[lane];
+        best = first + lane;
+      }
+    }
+  }
+  return best;
+}
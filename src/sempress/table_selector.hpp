@@ -0,0 +1,53 @@
+/**
+ * @file table_selector.hpp
+ * @brief Definition of the TableSelector class, which picks the table a
+ * block is encoded with
+ */
+#pragma once
+#include "huffman_tree.hpp"
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class TableSelector
+ * @brief Estimates which of several tables encodes a block in fewest bits
+ *
+ * Each table is reduced to the cost in bits of every byte value: its
+ * share of the codes of the symbols it appears in, weighted by how often
+ * their code lengths say they occur, or MISSING_COST if the table has no
+ * code for the single character (such bytes would be skipped). A table
+ * whose multi-character symbols cover most of the text is thus judged by
+ * them, not by the long codes left to its single characters. The
+ * estimate for a block is the dot product of its byte histogram with
+ * those costs.
+ *
+ * The costs are stored in groups of LANES tables, interleaved byte by
+ * byte, so one pass over the histogram updates the totals of a whole
+ * group with a fixed-width inner loop the compiler turns into vector
+ * instructions.
+ */
+class TableSelector {
+public:
+  static constexpr unsigned LANES = 4;          ///< Tables scored together
+  static constexpr double MISSING_COST = 1e6;   ///< Cost of a byte without a code
+
+  /**
+   * @brief Builds the cost tables of a set of trees
+   *
+   * @param trees Trees to choose from, by table id
+   */
+  explicit TableSelector(const std::vector<HuffmanTree> &trees);
+
+  /**
+   * @brief Returns the table estimated to encode a block in fewest bits
+   *
+   * @param block Uncompressed bytes of the block
+   * @return size_t Table id; ties go to the lowest id
+   */
+  size_t select(std::string_view block) const;
+
+private:
+  size_t tableCount = 0;     ///< Number of tables
+  std::vector<double> costs; ///< [group][byte][lane] cost in bits
+};
@@ -0,0 +1,38 @@
+/**
+ * @file thread_pool.cpp
+ * @brief Implementation of the worker thread pool
+ */
+#include "thread_pool.hpp"
+
+unsigned ThreadPool::resolve(unsigned threads) {
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  return threads == 0 ? 1 : threads;
+}
+
+ThreadPool::ThreadPool(unsigned threads) {
+  threads = resolve(threads);
+  for (unsigned i = 0; i < threads; i++) {
+    workers.emplace_back([this] {
+      while (true) {
+        std::function<void()> task;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          ready.wait(lock, [this] { return stopping or not tasks.empty(); });
+          if (tasks.empty()) return; // stopping and nothing left to run
+          task = std::move(tasks.front());
+          tasks.pop();
+        }
+        task();
+      }
+    });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  ready.notify_all();
+  for (auto &worker : workers) worker.join();
+}
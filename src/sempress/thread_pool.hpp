@@ -0,0 +1,82 @@
+/**
+ * @file thread_pool.hpp
+ * @brief Definition of the ThreadPool class, a fixed set of worker threads
+ * consuming a task queue
+ */
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class ThreadPool
+ * @brief Runs submitted tasks on a fixed number of worker threads
+ *
+ * Tasks run in submission order as workers become free. Each submission
+ * returns a std::future, so callers can collect results in the order they
+ * need them, and exceptions thrown by a task are rethrown by get().
+ */
+class ThreadPool {
+public:
+  /**
+   * @brief Starts the worker threads
+   *
+   * @param threads Number of workers; 0 uses the number of hardware threads
+   */
+  explicit ThreadPool(unsigned threads);
+
+  /**
+   * @brief Waits for the queued tasks to finish and joins the workers
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * @brief Queues a task
+   *
+   * @param task Callable taking no arguments
+   * @return std::future holding the result of the task
+   */
+  template <typename Task>
+  auto submit(Task task) -> std::future<std::invoke_result_t<Task>> {
+    using Result = std::invoke_result_t<Task>;
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    std::future<Result> result = packaged->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.push([packaged] { (*packaged)(); });
+    }
+    ready.notify_one();
+    return result;
+  }
+
+  /**
+   * @brief Returns the number of worker threads
+   *
+   * @return unsigned Number of workers
+   */
+  unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+  /**
+   * @brief Resolves a requested thread count
+   *
+   * @param threads Requested count; 0 means one per hardware thread
+   * @return unsigned Thread count, at least 1
+   */
+  static unsigned resolve(unsigned threads);
+
+private:
+  std::vector<std::thread> workers;        ///< Worker threads
+  std::queue<std::function<void()>> tasks; ///< Tasks waiting for a worker
+  std::mutex mutex;                        ///< Guards tasks and stopping
+  std::condition_variable ready;           ///< Signals new tasks or stop
+  bool stopping = false;                   ///< Set when the pool shuts down
+};
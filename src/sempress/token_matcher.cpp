@@ -0,0 +1,205 @@
+/**
+ * @file token_matcher.cpp
+ * @brief Implementation of the TokenMatcher byte trie
+ */
+#include "token_matcher.hpp"
+#include "byte_order.hpp"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+TokenMatcher::TokenMatcher() { rootChildren.fill(NO_NODE); }
+
+/**
+ * @brief Compiles the given symbols into the trie
+ *
+ * The trie is first built with ordered child maps, which keeps the
+ * insertion simple, and then flattened breadth-first into the node and
+ * edge arrays used by the lookups.
+ *
+ * @param symbols Symbols to be matched (empty strings are ignored)
+ */
+TokenMatcher::TokenMatcher(const std::vector<std::string> &symbols)
+    : TokenMatcher() {
+  struct BuildNode {
+    int symbol = NO_MATCH;
+    std::map<unsigned char, size_t> children;
+  };
+  std::vector<BuildNode> trie(1); // trie[0] is the root
+
+  for (size_t id = 0; id < symbols.size(); id++) {
+    const std::string &symbol = symbols[id];
+    if (symbol.empty()) continue;
+
+    size_t current = 0;
+    for (char c : symbol) {
+      auto label = static_cast<unsigned char>(c);
+      auto it = trie[current].children.find(label);
+      if (it == trie[current].children.end()) {
+        trie.emplace_back();
+        it = trie[current].children.emplace(label, trie.size() - 1).first;
+      }
+      current = it->second;
+    }
+    trie[current].symbol = static_cast<int>(id);
+    maxLength = std::max(maxLength, symbol.length());
+  }
+
+  // Flattens the trie breadth-first: flat[i] is the build node of nodes[i]
+  std::vector<size_t> flat;
+  for (const auto &[label, next] : trie[0].children) {
+    rootChildren[label] = static_cast<uint32_t>(flat.size());
+    flat.push_back(next);
+  }
+
+  for (size_t i = 0; i < flat.size(); i++) {
+    const BuildNode &source = trie[flat[i]];
+    Node node;
+    node.symbol = source.symbol;
+    node.firstEdge = static_cast<uint32_t>(edges.size());
+    node.edgeCount = static_cast<uint32_t>(source.children.size());
+    for (const auto &[label, next] : source.children) {
+      edges.push_back({label, static_cast<uint32_t>(flat.size())});
+      flat.push_back(next);
+    }
+    nodes.push_back(node);
+  }
+}
+
+uint32_t TokenMatcher::child(const Node &node, unsigned char label) const {
+  const Edge *edge = edges.data() + node.firstEdge;
+  const Edge *end = edge + node.edgeCount;
+  // Edges are sorted by label, so the scan can stop at the first larger one
+  for (; edge != end and edge->label <= label; ++edge) {
+    if (edge->label == label) return edge->child;
+  }
+  return NO_NODE;
+}
+
+/**
+ * @brief Finds the longest symbol that is a prefix of the given data
+ *
+ * Walks the trie one byte at a time, remembering the deepest node that
+ * ends a symbol, and stops as soon as there is no edge for the next byte.
+ *
+ * @param data Pointer to the current position of the input
+ * @param size Number of bytes available from data onwards
+ * @param symbolId Receives the id of the matched symbol, or NO_MATCH
+ * @return size_t Length of the match in bytes (0 if nothing matches)
+ *
+ * @note Complexity: O(L) where L is the length of the longest symbol
+ */
+size_t TokenMatcher::longestMatch(const char *data, size_t size,
+                                  int &symbolId) const {
+  symbolId = NO_MATCH;
+  if (size == 0) return 0;
+
+  size_t best = 0;
+  size_t depth = 1;
+  uint32_t current = rootChildren[static_cast<unsigned char>(data[0])];
+
+  while (current != NO_NODE) {
+    const Node &node = nodes[current];
+    if (node.symbol != NO_MATCH) {
+      symbolId = node.symbol;
+      best = depth;
+    }
+    if (depth == size or node.edgeCount == 0) break;
+    current = child(node, static_cast<unsigned char>(data[depth]));
+    depth++;
+  }
+
+  return best;
+}
+
+/**
+ * @brief Appends the compiled trie to a buffer
+ *
+ * Layout: longest symbol length, node count and edge count, the 256 root
+ * children, then 3 integers per node and 2 per edge, all 4-byte
+ * little-endian.
+ *
+ * @param bytes Buffer receiving the trie
+ */
+void TokenMatcher::save(std::string &bytes) const {
+  putUint32(bytes, static_cast<uint32_t>(maxLength));
+  putUint32(bytes, static_cast<uint32_t>(nodes.size()));
+  putUint32(bytes, static_cast<uint32_t>(edges.size()));
+  for (uint32_t child : rootChildren) putUint32(bytes, child);
+  for (const Node &node : nodes) {
+    putUint32(bytes, static_cast<uint32_t>(node.symbol));
+    putUint32(bytes, node.firstEdge);
+    putUint32(bytes, node.edgeCount);
+  }
+  for (const Edge &edge : edges) {
+    putUint32(bytes, edge.label);
+    putUint32(bytes, edge.child);
+  }
+}
+
+/**
+ * @brief Restores a trie written by save()
+ *
+ * Every index is checked, and children must come after their parent (the
+ * breadth-first order of save()), so a damaged file cannot make a lookup
+ * read out of bounds or loop.
+ *
+ * @param data Start of the stored trie
+ * @param size Bytes available from data onwards
+ * @param symbolCount Number of symbols the ids may refer to
+ * @return size_t Number of bytes read
+ * @throws std::runtime_error If the stored trie is truncated or invalid
+ */
+size_t TokenMatcher::load(const unsigned char *data, size_t size,
+                          size_t symbolCount) {
+  auto invalid = [] { return std::runtime_error("Invalid compiled token matcher."); };
+
+  if (size < 12) throw invalid();
+  const size_t storedMax = getUint32(data);
+  const size_t nodeCount = getUint32(data + 4);
+  const size_t edgeCount = getUint32(data + 8);
+  const size_t total = 12 + 4 * (256 + 3 * nodeCount + 2 * edgeCount);
+  if (nodeCount > size or edgeCount > size or total > size) throw invalid();
+
+  const unsigned char *p = data + 12;
+  std::array<uint32_t, 256> root;
+  for (uint32_t &child : root) {
+    child = getUint32(p);
+    p += 4;
+    if (child != NO_NODE and child >= nodeCount) throw invalid();
+  }
+
+  std::vector<Node> loadedNodes(nodeCount);
+  for (Node &node : loadedNodes) {
+    node.symbol = static_cast<int32_t>(getUint32(p));
+    node.firstEdge = getUint32(p + 4);
+    node.edgeCount = getUint32(p + 8);
+    p += 12;
+    if ((node.symbol != NO_MATCH and (node.symbol < 0 or static_cast<size_t>(node.symbol) >= symbolCount)) or
+        node.firstEdge > edgeCount or node.edgeCount > edgeCount - node.firstEdge) {
+      throw invalid();
+    }
+  }
+
+  std::vector<Edge> loadedEdges(edgeCount);
+  for (Edge &edge : loadedEdges) {
+    uint32_t label = getUint32(p);
+    edge.child = getUint32(p + 4);
+    p += 8;
+    if (label > UINT8_MAX or edge.child >= nodeCount) throw invalid();
+    edge.label = static_cast<unsigned char>(label);
+  }
+
+  for (size_t i = 0; i < nodeCount; i++) {
+    const Node &node = loadedNodes[i];
+    for (uint32_t e = node.firstEdge; e < node.firstEdge + node.edgeCount; e++) {
+      if (loadedEdges[e].child <= i) throw invalid();
+    }
+  }
+
+  rootChildren = root;
+  nodes = std::move(loadedNodes);
+  edges = std::move(loadedEdges);
+  maxLength = storedMax;
+  return total;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file token_matcher.hpp
+ * @brief Definition of the TokenMatcher class, a byte trie used to find the
+ * longest symbol of the code table at a position of the input
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class TokenMatcher
+ * @brief Precompiled longest-match finder over the symbols of a code table
+ *
+ * The symbols are compiled once into a flat byte trie. The root keeps a
+ * direct 256-entry child table, since every lookup starts there, while the
+ * deeper nodes keep their outgoing edges sorted in a shared edge array.
+ * A lookup walks the trie from the current position and remembers the
+ * deepest node that ends a symbol, so it never allocates and never touches
+ * symbols that cannot match.
+ */
+class TokenMatcher {
+public:
+  /// Value returned as symbol id when no symbol matches
+  static constexpr int NO_MATCH = -1;
+
+  /**
+   * @brief Default constructor - creates a matcher that matches nothing
+   */
+  TokenMatcher();
+
+  /**
+   * @brief Compiles the given symbols into the trie
+   *
+   * The id of each symbol is its index in the vector.
+   *
+   * @param symbols Symbols to be matched (empty strings are ignored)
+   */
+  explicit TokenMatcher(const std::vector<std::string> &symbols);
+
+  /**
+   * @brief Finds the longest symbol that is a prefix of the given data
+   *
+   * @param data Pointer to the current position of the input
+   * @param size Number of bytes available from data onwards
+   * @param symbolId Receives the id of the matched symbol, or NO_MATCH
+   * @return size_t Length of the match in bytes (0 if nothing matches)
+   */
+  size_t longestMatch(const char *data, size_t size, int &symbolId) const;
+
+  /**
+   * @brief Calls a function for every symbol that is a prefix of the data
+   *
+   * Used by parsers that weigh all the candidates at a position instead
+   * of taking the longest one. Matches are reported shortest first.
+   *
+   * @param data Pointer to the current position of the input
+   * @param size Number of bytes available from data onwards
+   * @param fn Called with the length and the id of each match
+   */
+  template <typename Fn>
+  void forEachMatch(const char *data, size_t size, Fn fn) const {
+    if (size == 0) return;
+
+    size_t depth = 1;
+    uint32_t current = rootChildren[static_cast<unsigned char>(data[0])];
+    while (current != NO_NODE) {
+      const Node &node = nodes[current];
+      if (node.symbol != NO_MATCH) fn(depth, node.symbol);
+      if (depth == size or node.edgeCount == 0) break;
+      current = child(node, static_cast<unsigned char>(data[depth]));
+      depth++;
+    }
+  }
+
+  /**
+   * @brief Returns the length of the longest compiled symbol
+   *
+   * @return size_t Length in bytes
+   */
+  size_t maxSymbolLength() const { return maxLength; }
+
+  /**
+   * @brief Appends the compiled trie to a buffer
+   *
+   * The node and edge arrays are stored as little-endian integers, so
+   * load() restores them without building the trie again.
+   *
+   * @param bytes Buffer receiving the trie
+   */
+  void save(std::string &bytes) const;
+
+  /**
+   * @brief Restores a trie written by save()
+   *
+   * @param data Start of the stored trie
+   * @param size Bytes available from data onwards
+   * @param symbolCount Number of symbols the ids may refer to
+   * @return size_t Number of bytes read
+   * @throws std::runtime_error If the stored trie is truncated or invalid
+   */
+  size_t load(const unsigned char *data, size_t size, size_t symbolCount);
+
+private:
+  static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+  /// Trie node: symbol ending here and the range of its outgoing edges
+  struct Node {
+    int32_t symbol = NO_MATCH;
+    uint32_t firstEdge = 0;
+    uint32_t edgeCount = 0;
+  };
+
+  /// Labeled edge towards a child node
+  struct Edge {
+    unsigned char label;
+    uint32_t child;
+  };
+
+  std::array<uint32_t, 256> rootChildren; ///< Direct child table of the root
+  std::vector<Node> nodes;                ///< Non-root nodes, in BFS order
+  std::vector<Edge> edges;                ///< Edges grouped by parent node
+  size_t maxLength = 0;                   ///< Longest compiled symbol
+
+  /**
+   * @brief Returns the child of a node reached through a byte
+   *
+   * @param node Parent node
+   * @param label Byte of the edge
+   * @return uint32_t Index of the child, or NO_NODE
+   */
+  uint32_t child(const Node &node, unsigned char label) const;
+};
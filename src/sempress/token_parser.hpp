@@ -0,0 +1,167 @@
+/**
+ * @file token_parser.hpp
+ * @brief Splitting of the input into the tokens of a code table, shared by
+ * the file compressor and the in-memory codec
+ */
+#pragma once
+#include "huffman_tree.hpp"
+#include "stats.hpp"
+#include "token_matcher.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @struct Parser
+ * @brief Codes, token trie and parse strategy shared by the encoders
+ */
+struct Parser {
+  const HuffmanTree &tree;     ///< Huffman tree holding the codes
+  const TokenMatcher &matcher; ///< Trie compiled from the symbols of the tree
+  bool optimal;                ///< Chooses tokens by encoded size instead of length
+};
+
+/**
+ * @brief Splits the input into the longest tokens starting before a limit
+ *
+ * @param matcher Trie compiled from the symbols of the tree
+ * @param data First byte to encode
+ * @param limit Tokens may only start before this position
+ * @param size Bytes available from data, for the matches
+ * @param skipped Incremented by the number of bytes skipped
+ * @param emit Called with the symbol id of each token, in order
+ * @return size_t Position after the last token
+ */
+template <typename Emit>
+size_t greedyTokens(const TokenMatcher &matcher, const char *data,
+                    size_t limit, size_t size, size_t &skipped, Emit emit) {
+  Stats::Counters &stats = Stats::local();
+  size_t pos = 0;
+  while (pos < limit) {
+    // Finds the largest token that matches the current position
+    int symbol;
+    size_t length = matcher.longestMatch(data + pos, size - pos, symbol);
+
+    if (length > 0) {
+      // If a token was found, encode the token
+      emit(symbol);
+      stats.token(length);
+      pos += length;
+    } else {
+      // Characters missing from the table have no code and are skipped
+      pos++;
+      skipped++;
+      stats.dropped();
+    }
+  }
+  stats.read(pos);
+  return pos;
+}
+
+/// Input bytes parsed together by the optimal parser
+constexpr size_t PARSE_WINDOW_SIZE = 1 << 18;
+
+/// Cost of a skipped byte in the optimal parse, above any window of codes,
+/// so a path that loses fewer bytes is always preferred
+constexpr uint64_t SKIP_COST = uint64_t{1} << 40;
+
+/// Cheapest way to encode the input from one position onwards
+struct ParseStep {
+  uint64_t bits;    ///< Encoded size of the rest of the window
+  int32_t symbol;   ///< Token chosen at this position, or NO_MATCH
+  uint32_t length;  ///< Bytes covered by the token (1 when skipped)
+};
+
+/**
+ * @brief Splits the input into the tokens with the fewest encoded bits
+ *
+ * The input is parsed in windows of PARSE_WINDOW_SIZE bytes. In each one,
+ * the cheapest encoding of every suffix is computed from the end (a
+ * shortest path over the candidate tokens, weighted by their code
+ * lengths), then the tokens are emitted from the start. A window also
+ * sees the bytes a token starting inside it may cover, so memory stays
+ * bounded by the window size whatever the input size.
+ *
+ * @param tree Huffman tree holding the code lengths
+ * @param matcher Trie compiled from the symbols of the tree
+ * @param data First byte to encode
+ * @param limit Tokens may only start before this position
+ * @param size Bytes available from data, for the matches
+ * @param skipped Incremented by the number of bytes skipped
+ * @param emit Called with the symbol id of each token, in order
+ * @return size_t Position after the last token
+ */
+template <typename Emit>
+size_t optimalTokens(const HuffmanTree &tree, const TokenMatcher &matcher,
+                     const char *data, size_t limit, size_t size,
+                     size_t &skipped, Emit emit) {
+  const std::vector<HuffmanCode> &codes = tree.getCodes();
+  const size_t lookahead = std::max<size_t>(matcher.maxSymbolLength(), 1);
+
+  // Reused by the windows of the calling thread
+  thread_local std::vector<ParseStep> steps;
+  Stats::Counters &stats = Stats::local();
+
+  size_t pos = 0;
+  while (pos < limit) {
+    const size_t windowLimit = std::min(limit, pos + PARSE_WINDOW_SIZE);
+    const size_t windowEnd = std::min(size, windowLimit + lookahead - 1);
+    const size_t count = windowEnd - pos;
+    const char *window = data + pos;
+
+    // steps[i] is the cheapest encoding of window[i..count)
+    steps.resize(count + 1);
+    steps[count] = {0, TokenMatcher::NO_MATCH, 0};
+    for (size_t i = count; i-- > 0;) {
+      ParseStep best = {UINT64_MAX, TokenMatcher::NO_MATCH, 1};
+      matcher.forEachMatch(window + i, count - i, [&](size_t length, int symbol) {
+        const uint64_t bits = codes[symbol].length + steps[i + length].bits;
+        // Equal costs keep the longer token, so fewer codes are written
+        if (bits <= best.bits) {
+          best = {bits, symbol, static_cast<uint32_t>(length)};
+        }
+      });
+      // Characters missing from the table have no code and are skipped
+      if (best.symbol == TokenMatcher::NO_MATCH) best.bits = SKIP_COST + steps[i + 1].bits;
+      steps[i] = best;
+    }
+
+    // Follows the cheapest path up to the end of the window
+    const size_t stop = windowLimit - pos;
+    size_t i = 0;
+    while (i < stop) {
+      if (steps[i].symbol == TokenMatcher::NO_MATCH) {
+        skipped++;
+        stats.dropped();
+      } else {
+        emit(steps[i].symbol);
+        stats.token(steps[i].length);
+      }
+      i += steps[i].length;
+    }
+    pos += i;
+  }
+  stats.read(pos);
+  return pos;
+}
+
+/**
+ * @brief Splits the input into the tokens starting before a limit
+ *
+ * @param parser Codes, trie and parse strategy
+ * @param data First byte to encode
+ * @param limit Tokens may only start before this position
+ * @param size Bytes available from data, for the matches
+ * @param skipped Incremented by the number of bytes skipped
+ * @param emit Called with the symbol id of each token, in order
+ * @return size_t Position after the last token
+ */
+template <typename Emit>
+size_t scanTokens(const Parser &parser, const char *data, size_t limit,
+                  size_t size, size_t &skipped, Emit emit) {
+  if (parser.optimal) {
+    return optimalTokens(parser.tree, parser.matcher, data, limit, size, skipped, emit);
+  }
+  return greedyTokens(parser.matcher, data, limit, size, skipped, emit);
+}
@@ -0,0 +1,212 @@
+#include "count-cache.hpp"
+#include "../sempress/byte_order.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+/// Identifies a count cache file.
+static constexpr char MAGIC[3] = {'J', 'F', 'C'};
+
+/// Version of the layout, bumped when it changes.
+static constexpr unsigned char VERSION = 1;
+
+/**
+ * @brief Hashes the contents of a file, to recognize it when only its
+ * modification time changed.
+ *
+ * Eight bytes are mixed in per multiplication, so hashing costs little
+ * next to counting.
+ *
+ * @param data Bytes to hash.
+ * @param size Number of bytes.
+ * @return 64-bit hash (not cryptographic).
+ */
+uint64_t hash_bytes(const char* data, size_t size) {
+    constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+    uint64_t hash = size * multiplier;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    hash = (hash ^ tail) * multiplier;
+    return hash ^ (hash >> 32);
+}
+
+/**
+ * @brief Appends an unsigned integer in 7-bit groups, lowest first.
+ * @param bytes Output buffer.
+ * @param value Integer to append.
+ */
+static void put_varint(std::string& bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<char>(value));
+}
+
+/**
+ * @brief Bounds-checked reader over the bytes of a cache file.
+ *
+ * Reading past the end, or a malformed integer, marks the reader as
+ * failed and returns zeros from then on.
+ */
+struct cache_reader {
+    const unsigned char* data;
+    size_t size;
+    size_t pos = 0;
+    bool failed = false;
+
+    bool has(size_t count) {
+        if (failed || size - pos < count) failed = true;
+        return !failed;
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64 && has(1); shift += 7) {
+            const unsigned char byte = data[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        failed = true;
+        return 0;
+    }
+
+    uint64_t uint64() {
+        if (!has(8)) return 0;
+        pos += 8;
+        return getUint64(data + pos - 8);
+    }
+
+    std::string text() {
+        const uint64_t length = varint();
+        if (!has(length)) return std::string();
+        pos += length;
+        return std::string(reinterpret_cast<const char*>(data) + pos - length, length);
+    }
+};
+
+/**
+ * @brief Loads a count cache written for a set of symbols.
+ *
+ * The file ends with the hash of everything before it, so a cache cut
+ * short by a crash is detected. Slots of the cache are renumbered to the
+ * current ids: symbols by their text, bytes by their value.
+ *
+ * @param path Path to the cache file.
+ * @param symbols Symbols of the counter, by id.
+ * @return Cached counts, their slots renumbered to the ids of symbols.
+ */
+count_cache load_count_cache(const std::string& path, const std::vector<std::string>& symbols) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return count_cache();
+    const std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    const size_t header = sizeof(MAGIC) + 1;
+    if (bytes.size() < header + 8 || bytes.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0 ||
+        static_cast<unsigned char>(bytes[sizeof(MAGIC)]) != VERSION) {
+        return count_cache();
+    }
+    const size_t end = bytes.size() - 8;
+    const auto* data = reinterpret_cast<const unsigned char*>(bytes.data());
+    if (hash_bytes(bytes.data(), end) != getUint64(data + end)) return count_cache();
+
+    cache_reader reader{data, end, header};
+
+    // The cache must describe exactly the same symbols
+    std::unordered_map<std::string, uint32_t> ids;
+    for (size_t id = 0; id < symbols.size(); id++) ids.emplace(symbols[id], static_cast<uint32_t>(id));
+    const uint64_t symbol_count = reader.varint();
+    if (reader.failed || symbol_count != symbols.size()) return count_cache();
+
+    std::vector<uint32_t> slots(symbol_count + 256);
+    std::vector<bool> seen(symbols.size(), false);
+    for (uint64_t slot = 0; slot < symbol_count; slot++) {
+        auto id = ids.find(reader.text());
+        if (reader.failed || id == ids.end() || seen[id->second]) return count_cache();
+        seen[id->second] = true;
+        slots[slot] = id->second;
+    }
+    for (uint32_t byte = 0; byte < 256; byte++) slots[symbol_count + byte] = static_cast<uint32_t>(symbols.size()) + byte;
+
+    count_cache cache;
+    const uint64_t file_count = reader.varint();
+    for (uint64_t i = 0; i < file_count && !reader.failed; i++) {
+        const std::string file_path = reader.text();
+        cached_counts& entry = cache[file_path];
+        entry.size = reader.uint64();
+        entry.mtime = static_cast<int64_t>(reader.uint64());
+        entry.hash = reader.uint64();
+
+        const uint64_t count = reader.varint();
+        if (!reader.has(count)) break;
+        entry.counts.reserve(count);
+        for (uint64_t j = 0; j < count; j++) {
+            const uint64_t slot = reader.varint();
+            const uint64_t value = reader.varint();
+            if (slot >= slots.size()) reader.failed = true;
+            if (reader.failed) break;
+            entry.counts.push_back({slots[slot], value});
+        }
+    }
+    if (reader.failed || reader.pos != end) return count_cache();
+    return cache;
+}
+
+/**
+ * @brief Writes a count cache, replacing the previous one at once.
+ *
+ * The cache is written next to its final path and renamed over it, so a
+ * run that stops halfway leaves the previous cache in place.
+ *
+ * @param path Path to the cache file.
+ * @param symbols Symbols of the counter, by id.
+ * @param cache Counts of the files to keep.
+ * @throws std::runtime_error If the cache cannot be written.
+ */
+void save_count_cache(const std::string& path, const std::vector<std::string>& symbols, const count_cache& cache) {
+    std::string bytes(MAGIC, sizeof(MAGIC));
+    bytes.push_back(static_cast<char>(VERSION));
+
+    put_varint(bytes, symbols.size());
+    for (const std::string& symbol : symbols) {
+        put_varint(bytes, symbol.size());
+        bytes += symbol;
+    }
+
+    put_varint(bytes, cache.size());
+    for (const auto& [file_path, entry] : cache) {
+        put_varint(bytes, file_path.size());
+        bytes += file_path;
+        putUint64(bytes, entry.size);
+        putUint64(bytes, static_cast<uint64_t>(entry.mtime));
+        putUint64(bytes, entry.hash);
+        put_varint(bytes, entry.counts.size());
+        for (const auto& [slot, count] : entry.counts) {
+            put_varint(bytes, slot);
+            put_varint(bytes, count);
+        }
+    }
+    putUint64(bytes, hash_bytes(bytes.data(), bytes.size()));
+
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!file) throw std::runtime_error("Error writing count cache: " + temporary);
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Error replacing count cache: " + path);
+    }
+}
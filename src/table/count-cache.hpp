@@ -0,0 +1,67 @@
+/**
+ * @file count-cache.hpp
+ * @brief Persistent cache of the symbol counts of each file, so a table
+ * rebuild only scans the files that changed.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef COUNT_CACHE_HPP
+#define COUNT_CACHE_HPP
+
+/**
+ * @brief Counts of one file, and what identifies the contents they describe.
+ *
+ * Counts are sparse (slot, count) pairs in the layout of the counter: one
+ * slot per symbol id, then 256 slots for the bytes.
+ */
+struct cached_counts {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+    std::vector<std::pair<uint32_t, uint64_t>> counts;
+};
+
+/**
+ * @brief Cached counts by file path.
+ */
+using count_cache = std::unordered_map<std::string, cached_counts>;
+
+/**
+ * @brief Hashes the contents of a file, to recognize it when only its
+ * modification time changed.
+ * @param data Bytes to hash.
+ * @param size Number of bytes.
+ * @return 64-bit hash (not cryptographic).
+ */
+uint64_t hash_bytes(const char* data, size_t size);
+
+/**
+ * @brief Loads a count cache written for a set of symbols.
+ *
+ * The counts of a file depend on every symbol of the table, since the
+ * parse takes the longest one, so a cache written for another set of
+ * symbols is ignored as a whole. A missing, damaged or outdated cache
+ * gives an empty one: it only costs a full count.
+ *
+ * @param path Path to the cache file.
+ * @param symbols Symbols of the counter, by id.
+ * @return Cached counts, their slots renumbered to the ids of symbols.
+ */
+count_cache load_count_cache(const std::string& path, const std::vector<std::string>& symbols);
+
+/**
+ * @brief Writes a count cache, replacing the previous one at once.
+ * @param path Path to the cache file.
+ * @param symbols Symbols of the counter, by id.
+ * @param cache Counts of the files to keep.
+ * @throws std::runtime_error If the cache cannot be written.
+ */
+void save_count_cache(const std::string& path, const std::vector<std::string>& symbols, const count_cache& cache);
+
+#endif
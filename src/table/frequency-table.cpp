@@ -1,4 +1,9 @@
 #include "frequency-table.hpp"
+#include "count-cache.hpp"
+#include "../sempress/byte_histogram.hpp"
+#include "../sempress/mapped_file.hpp"
+#include "../sempress/stats.hpp"
+#include "../sempress/token_matcher.hpp"
 
 #include <iostream>
 #include <filesystem>
@@ -7,6 +12,16 @@
 #include <unordered_set>
 #include <fstream>
 #include <unordered_map>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
 namespace fs = std::filesystem;
 
 /**
@@ -77,50 +92,182 @@ std::unordered_map<std::string, int> create_unordered_map_from_file(std::string
 }
 
 /**
- * @brief Parses a line into tokens, separating by spaces.
- * @param str Input string.
- * @return Vector of tokens.
- */
-std::vector<std::string> line_parser(const std::string str) {
-    std::vector<std::string> tks;
-    int idx = 0;
-
-    for (int i = 0; i < (int) str.size(); i++) {
-        if (str[i] == ' ' || i == (int) str.size() - 1) {
-            std::string tk;
-            
-            if (str[i] == ' ') {
-                tk = str.substr(idx, i - idx);
-                tks.push_back(" ");
-                idx = i + 1;
-            } else {
-                tk = str.substr(idx, i - idx + 1);
+ * @brief Symbols of the table compiled for counting.
+ *
+ * Characters and keywords share one id space, characters first. Counts are
+ * kept in flat arrays indexed by symbol id, followed by 256 slots for the
+ * bytes that match no symbol.
+ *
+ * While scanning, only the symbols of several bytes are counted by id; the
+ * byte slots hold the histogram of every byte scanned, and settle_counts()
+ * later turns the bytes that were not part of a longer symbol into
+ * single-character counts.
+ */
+struct compiled_symbols {
+    std::vector<std::string> symbols;
+    size_t chars_count = 0;
+    TokenMatcher matcher;
+    int byte_ids[256];
+};
+
+/**
+ * @brief Compiles the keys of the maps into a single keyword automaton.
+ * @param keywords_map Map of keywords.
+ * @param chars_map Map of characters.
+ * @return Symbols and the trie matching them.
+ */
+static compiled_symbols compile_symbols(const std::unordered_map<std::string, int>& keywords_map, const std::unordered_map<std::string, int>& chars_map) {
+    compiled_symbols compiled;
+
+    for (const auto& [word, count] : chars_map) compiled.symbols.push_back(word);
+    compiled.chars_count = compiled.symbols.size();
+    for (const auto& [word, count] : keywords_map) compiled.symbols.push_back(word);
+
+    compiled.matcher = TokenMatcher(compiled.symbols);
+
+    // Id the parse gives to each byte when it is a token on its own
+    for (int byte = 0; byte < 256; byte++) {
+        const char c = static_cast<char>(byte);
+        if (compiled.matcher.longestMatch(&c, 1, compiled.byte_ids[byte]) == 0) {
+            compiled.byte_ids[byte] = TokenMatcher::NO_MATCH;
+        }
+    }
+    return compiled;
+}
+
+/**
+ * @brief Counts the symbols of a buffer.
+ *
+ * At each position the longest symbol is taken, the same greedy parse the
+ * compressor does, so the counts match what it will encode. A carriage
+ * return ending a line is skipped, like the line reader used to do, unless
+ * the counts must describe every byte.
+ *
+ * Symbols of several bytes are counted by id as they are found; every
+ * byte scanned is counted by the histogram kernel into the byte slots,
+ * from which settle_counts() derives the single characters. Without any
+ * symbol of several bytes, every byte is a token of its own and the parse
+ * is skipped altogether.
+ *
+ * @param data Buffer to scan.
+ * @param limit Symbols may only start before this position.
+ * @param size Size of the buffer, for the matches.
+ * @param compiled Compiled symbols.
+ * @param counts Counts by symbol id, then by byte.
+ * @param keep_cr Counts carriage returns ending a line too.
+ * @return Position after the last symbol counted.
+ */
+static size_t count_frequencies_in_buffer(const char* data, size_t limit, size_t size, const compiled_symbols& compiled, std::vector<uint64_t>& counts, bool keep_cr = false) {
+    uint64_t* byte_counts = counts.data() + compiled.symbols.size();
+    uint64_t skipped_cr = 0;
+    size_t pos = 0;
+
+    if (compiled.matcher.maxSymbolLength() <= 1) {
+        pos = limit;
+        const char* cr = data;
+        while (!keep_cr && (cr = static_cast<const char*>(std::memchr(cr, '\r', data + limit - cr)))) {
+            if (cr + 1 == data + size || cr[1] == '\n') skipped_cr++;
+            cr++;
+        }
+    } else {
+        while (pos < limit) {
+            if (!keep_cr && data[pos] == '\r' && (pos + 1 == size || data[pos + 1] == '\n')) {
+                pos++;
+                skipped_cr++;
+                continue;
             }
 
-            tks.push_back(tk);
+            int symbol;
+            size_t length = compiled.matcher.longestMatch(data + pos, size - pos, symbol);
+
+            if (length > 1) counts[symbol]++;
+            pos += std::max<size_t>(length, 1);
         }
     }
 
-    return tks;
+    ByteHistogram::count(reinterpret_cast<const unsigned char*>(data), pos, byte_counts);
+    byte_counts[static_cast<unsigned char>('\r')] -= skipped_cr;
+    return pos;
 }
 
 /**
- * @brief Checks if a substring at a given index matches any keyword.
- * @param idx Index in the string.
- * @param str Input string.
- * @param keywords_unordered_map Map of keywords.
- * @return Matching keyword or empty string.
+ * @brief Turns the byte histogram of a scan into single-character counts.
+ *
+ * The bytes covered by the symbols of several bytes are taken out of the
+ * histogram; each remaining byte was a token of its own, counted under its
+ * single-character symbol, or left in its byte slot if it matched none.
+ *
+ * @param compiled Compiled symbols.
+ * @param counts Counts by symbol id, then by byte, as scanned.
  */
-std::string contains_keyword(int idx, const std::string& str, const std::unordered_map<std::string, int>& keywords_unordered_map) {
-    std::string out = "";
+static void settle_counts(const compiled_symbols& compiled, std::vector<uint64_t>& counts) {
+    uint64_t* byte_counts = counts.data() + compiled.symbols.size();
 
-    for (const auto& [word, count] : keywords_unordered_map) {
-        if (str.compare(idx, word.length(), word) == 0) {
-            out = word;
-        }
+    for (size_t id = 0; id < compiled.symbols.size(); id++) {
+        if (compiled.symbols[id].size() < 2) continue;
+        for (char c : compiled.symbols[id]) byte_counts[static_cast<unsigned char>(c)] -= counts[id];
+    }
+
+    for (int byte = 0; byte < 256; byte++) {
+        if (compiled.byte_ids[byte] == TokenMatcher::NO_MATCH) continue;
+        counts[compiled.byte_ids[byte]] += byte_counts[byte];
+        byte_counts[byte] = 0;
+    }
+}
+
+/**
+ * @brief Reads a whole file into a buffer, reusing its storage.
+ *
+ * Fallback for the files that cannot be memory-mapped.
+ *
+ * @param path Path to the file.
+ * @param buffer Buffer receiving the contents.
+ * @return True if the file could be read.
+ */
+static bool read_file(const std::string& path, std::string& buffer) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+
+    std::streamoff size = file.tellg();
+    if (size < 0) return false;
+    buffer.resize(static_cast<size_t>(size));
+    file.seekg(0);
+    file.read(buffer.data(), size);
+    buffer.resize(static_cast<size_t>(file.gcount()));
+    return true;
+}
+
+/**
+ * @brief Adds a count into a map entry, saturating at the largest int.
+ * @param entry Frequency in the map.
+ * @param count Count to add.
+ */
+static void add_count(int& entry, uint64_t count) {
+    const uint64_t sum = static_cast<uint64_t>(std::max(entry, 0)) + count;
+    entry = static_cast<int>(std::min<uint64_t>(sum, INT_MAX));
+}
+
+/**
+ * @brief Adds flat counts into the maps.
+ *
+ * Bytes that matched no symbol are added to the characters map, so the
+ * table covers every character seen.
+ *
+ * @param compiled Compiled symbols.
+ * @param counts Counts by symbol id, then by unmatched byte.
+ * @param keywords_map Map of keywords and their frequencies.
+ * @param chars_map Map of characters and their frequencies.
+ */
+static void merge_counts(const compiled_symbols& compiled, const std::vector<uint64_t>& counts, std::unordered_map<std::string, int>& keywords_map, std::unordered_map<std::string, int>& chars_map) {
+    for (size_t id = 0; id < compiled.symbols.size(); id++) {
+        auto& map = id < compiled.chars_count ? chars_map : keywords_map;
+        add_count(map[compiled.symbols[id]], counts[id]);
     }
 
-    return out;
+    for (size_t byte = 0; byte < 256; byte++) {
+        uint64_t count = counts[compiled.symbols.size() + byte];
+        if (count > 0) add_count(chars_map[std::string(1, static_cast<char>(byte))], count);
+    }
 }
 
 /**
@@ -130,54 +277,449 @@ std::string contains_keyword(int idx, const std::string& str, const std::unorder
  * @param chars_map Map of characters and their frequencies.
  */
 void count_frequencies_in_file(const std::string path, std::unordered_map<std::string, int>& keywords_map, std::unordered_map<std::string, int>& chars_map) {
-    std::ifstream file(path);
-    std::string line;
+    count_frequencies_in_various_files({path}, keywords_map, chars_map, 1);
+}
 
-    while (std::getline(file, line)) {
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-        std::vector<std::string> tks = line_parser(line);
-        tks.push_back("\n");
-        for (auto tk : tks) {
-            if (chars_map.find(tk) != chars_map.end()) {
-                chars_map[tk]++;
-            } else {
-                for (int i = 0; i < (int) tk.length(); i++) {
-                    std::string comparison = contains_keyword(i, tk, keywords_map);
-
-                    if (comparison != "") {
-                        keywords_map[comparison]++;
-                        i += comparison.length();
-                    } else {
-                        std::string s(1, tk[i]);
-
-                        if (chars_map.find(s) != chars_map.end()) {
-                            chars_map[s]++;
-                        } else {
-                            chars_map[s] = 1;
-                        }                        
-                    }
+/**
+ * @brief Counts a file, or takes its counts from the cache.
+ *
+ * A file whose size and modification time match its cache entry is not
+ * read at all. Otherwise it is read and hashed, and only scanned if its
+ * contents differ from the cached ones too (a file touched but unchanged
+ * is not scanned again).
+ *
+ * @param path Path to the file.
+ * @param compiled Compiled symbols.
+ * @param cache Counts of the previous run.
+ * @param counts Counts by symbol id, then by byte, added to.
+ * @param entry Receives the cache entry of the file.
+ * @param hit Set if the counts came from the cache.
+ * @return True if the file could be read.
+ */
+static bool count_cached_file(const std::string& path, const compiled_symbols& compiled, const count_cache& cache, std::vector<uint64_t>& counts, cached_counts& entry, bool& hit) {
+    std::error_code size_error, time_error;
+    entry.size = fs::file_size(path, size_error);
+    entry.mtime = fs::last_write_time(path, time_error).time_since_epoch().count();
+    if (size_error || time_error) return false;
+
+    // Takes the counts of the previous run, keeping the new modification time
+    const auto cached = cache.find(path);
+    auto take_cached = [&] {
+        hit = true;
+        entry.hash = cached->second.hash;
+        entry.counts = cached->second.counts;
+        for (const auto& [slot, count] : entry.counts) counts[slot] += count;
+        return true;
+    };
+    if (cached != cache.end() && cached->second.size == entry.size && cached->second.mtime == entry.mtime) {
+        return take_cached();
+    }
+
+    MappedFile mapped(path);
+    std::string buffer;
+    std::string_view data = mapped.view();
+    if (!mapped.isMapped()) {
+        if (!read_file(path, buffer)) return false;
+        data = buffer;
+    }
+    entry.size = data.size();
+    entry.hash = hash_bytes(data.data(), data.size());
+    if (cached != cache.end() && cached->second.size == entry.size && cached->second.hash == entry.hash) {
+        return take_cached();
+    }
+
+    std::vector<uint64_t> file_counts(counts.size(), 0);
+    count_frequencies_in_buffer(data.data(), data.size(), data.size(), compiled, file_counts);
+    Stats::local().read(data.size());
+
+    entry.counts.clear();
+    for (size_t slot = 0; slot < file_counts.size(); slot++) {
+        if (file_counts[slot] == 0) continue;
+        entry.counts.push_back({static_cast<uint32_t>(slot), file_counts[slot]});
+        counts[slot] += file_counts[slot];
+    }
+    return true;
+}
+
+/**
+ * @brief Counts frequencies in multiple files.
+ *
+ * The keywords and characters are compiled once into a trie, and each file
+ * is scanned once through it, with no allocation per line or token. Files
+ * are memory-mapped and scanned in place when possible.
+ *
+ * The files are shared among the worker threads through an atomic index, so
+ * a slow file does not hold back the others. Each worker counts into its own
+ * flat array, and the arrays are added up once all the files are done. Sums
+ * do not depend on the order of the files, so the result is the same as a
+ * serial run.
+ *
+ * With a cache, the counts of each file are also kept by path, and the
+ * files unchanged since the previous run are not scanned again. The cache
+ * is rewritten with the files of this run only, so removed files leave it.
+ *
+ * @param input_list List of file paths.
+ * @param keywords_map Map of keywords and their frequencies.
+ * @param chars_map Map of characters and their frequencies.
+ * @param threads Number of worker threads; 0 uses one per hardware thread.
+ * @param cache_path Path to the count cache; empty to count every file.
+ * @return Number of files whose counts came from the cache.
+ * @throws std::runtime_error If the cache cannot be written.
+ */
+size_t count_frequencies_in_various_files(const std::vector<std::string> input_list, std::unordered_map<std::string, int>& keywords_map, std::unordered_map<std::string, int>& chars_map, unsigned threads, const std::string& cache_path) {
+    Stats::PhaseTimer timer(Stats::COUNT);
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(input_list.size(), 1)));
+
+    const compiled_symbols compiled = compile_symbols(keywords_map, chars_map);
+    const size_t slots = compiled.symbols.size() + 256;
+
+    const bool caching = !cache_path.empty();
+    const count_cache cache = caching ? load_count_cache(cache_path, compiled.symbols) : count_cache();
+    std::vector<cached_counts> entries(caching ? input_list.size() : 0);
+    std::vector<char> readable(entries.size(), 0);
+    std::atomic<size_t> hits{0};
+
+    std::vector<std::vector<uint64_t>> local_counts(threads, std::vector<uint64_t>(slots, 0));
+    std::vector<std::exception_ptr> errors(threads);
+    std::atomic<size_t> next{0};
+
+    auto worker = [&](unsigned t) {
+        try {
+            std::string buffer;
+            for (size_t i = next++; i < input_list.size(); i = next++) {
+                if (caching) {
+                    bool hit = false;
+                    readable[i] = count_cached_file(input_list[i], compiled, cache, local_counts[t], entries[i], hit);
+                    if (hit) hits++;
+                    continue;
+                }
+
+                MappedFile mapped(input_list[i]);
+                if (mapped.isMapped()) {
+                    count_frequencies_in_buffer(mapped.view().data(), mapped.view().size(), mapped.view().size(), compiled, local_counts[t]);
+                    Stats::local().read(mapped.view().size());
+                } else if (read_file(input_list[i], buffer)) {
+                    count_frequencies_in_buffer(buffer.data(), buffer.size(), buffer.size(), compiled, local_counts[t]);
+                    Stats::local().read(buffer.size());
                 }
             }
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+
+    if (threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++) workers.emplace_back(worker, t);
+        for (auto& w : workers) w.join();
+    }
+
+    std::vector<uint64_t> counts(slots, 0);
+    for (unsigned t = 0; t < threads; t++) {
+        if (errors[t]) std::rethrow_exception(errors[t]);
+        for (size_t i = 0; i < slots; i++) counts[i] += local_counts[t][i];
+    }
+    settle_counts(compiled, counts);
+
+    // Tokens are counted from the sums, outside the scanning loop
+    Stats::Counters& stats = Stats::local();
+    for (size_t id = 0; id < slots; id++) {
+        stats.token(id < compiled.symbols.size() ? compiled.symbols[id].size() : 1, counts[id]);
+    }
+    merge_counts(compiled, counts, keywords_map, chars_map);
+
+    if (caching) {
+        count_cache updated;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (readable[i]) updated[input_list[i]] = std::move(entries[i]);
         }
+        save_count_cache(cache_path, compiled.symbols, updated);
     }
+    return hits;
 }
 
 /**
- * @brief Counts frequencies in multiple files.
- * @param input_list List of file paths.
+ * @brief Counts frequencies of keywords and characters in an input to compress.
+ *
+ * Unlike the table counters, every byte is counted, carriage returns
+ * included, since the counts describe exactly the bytes to encode. The
+ * file is scanned in slices; a symbol may only start in a slice where the
+ * longest symbol still fits, the rest is left to the next slice. Mapped
+ * pages are released once counted, so memory use does not depend on the
+ * file size.
+ *
+ * @param path Path to the file.
  * @param keywords_map Map of keywords and their frequencies.
  * @param chars_map Map of characters and their frequencies.
+ * @throws std::runtime_error If the file cannot be read.
+ */
+void count_frequencies_in_input(const std::string& path, std::unordered_map<std::string, int>& keywords_map, std::unordered_map<std::string, int>& chars_map) {
+    Stats::PhaseTimer timer(Stats::COUNT);
+    constexpr size_t slice_size = 1 << 20;
+
+    const compiled_symbols compiled = compile_symbols(keywords_map, chars_map);
+    std::vector<uint64_t> counts(compiled.symbols.size() + 256, 0);
+
+    MappedFile mapped(path);
+    std::string buffer;
+    if (!mapped.isMapped() && !read_file(path, buffer)) {
+        throw std::runtime_error("Error opening input file: " + path);
+    }
+    const std::string_view data = mapped.isMapped() ? mapped.view() : std::string_view(buffer);
+
+    const size_t lookahead = std::max<size_t>(compiled.matcher.maxSymbolLength(), 1);
+    size_t pos = 0;
+    while (pos < data.size()) {
+        const size_t size = data.size() - pos;
+        const size_t limit = size <= slice_size ? size : slice_size - (lookahead - 1);
+        pos += count_frequencies_in_buffer(data.data() + pos, limit, size, compiled, counts, true);
+        mapped.release(pos);
+    }
+
+    settle_counts(compiled, counts);
+    merge_counts(compiled, counts, keywords_map, chars_map);
+}
+
+/**
+ * @brief Counts of pairs of adjacent tokens, keyed by (left << 32) | right.
+ *
+ * Only the pairs seen take room: a corpus uses a small part of all the
+ * pairs of slots. Counting one token must stay cheap, so the table is
+ * open-addressed with linear probing in a flat array, grown to keep it at
+ * most half full.
+ */
+struct pair_counts {
+    static constexpr uint64_t EMPTY = ~0ull;
+
+    std::vector<std::pair<uint64_t, uint64_t>> entries = std::vector<std::pair<uint64_t, uint64_t>>(1024, {EMPTY, 0});
+    size_t used = 0;
+
+    void add(uint64_t key, uint64_t count) {
+        const size_t mask = entries.size() - 1;
+        size_t i = static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+        while (entries[i].first != key) {
+            if (entries[i].first == EMPTY) {
+                entries[i].first = key;
+                if (++used * 2 > entries.size()) {
+                    entries[i].second = count;
+                    grow();
+                    return;
+                }
+                break;
+            }
+            i = (i + 1) & mask;
+        }
+        entries[i].second += count;
+    }
+
+    void grow() {
+        std::vector<std::pair<uint64_t, uint64_t>> old(entries.size() * 2, {EMPTY, 0});
+        old.swap(entries);
+        used = 0;
+        for (const auto& [key, count] : old) {
+            if (key != EMPTY) add(key, count);
+        }
+    }
+};
+
+/**
+ * @brief Counts the tokens of a buffer and the pairs of adjacent tokens.
+ *
+ * The buffer is parsed like count_frequencies_in_buffer() does, but every
+ * token is counted by id, bytes that match no symbol in their byte slot,
+ * since the pairs need the exact sequence of tokens. A skipped carriage
+ * return breaks the sequence. In a run of the same token, each token is
+ * paired once, so a run of n is counted as the n / 2 pairs a merge would
+ * replace.
+ *
+ * @param data Buffer to parse.
+ * @param size Size of the buffer.
+ * @param compiled Compiled symbols.
+ * @param counts Counts by symbol id, then by byte.
+ * @param pairs Counts of the pairs of slots seen.
+ */
+static void count_pairs_in_buffer(const char* data, size_t size, const compiled_symbols& compiled, std::vector<uint64_t>& counts, pair_counts& pairs) {
+    const size_t slots = counts.size();
+    size_t previous = slots;
+    bool repeated = false;
+    size_t pos = 0;
+
+    while (pos < size) {
+        if (data[pos] == '\r' && (pos + 1 == size || data[pos + 1] == '\n')) {
+            pos++;
+            previous = slots;
+            continue;
+        }
+
+        int symbol;
+        const size_t length = compiled.matcher.longestMatch(data + pos, size - pos, symbol);
+        const size_t id = length > 0 ? static_cast<size_t>(symbol) : compiled.symbols.size() + static_cast<unsigned char>(data[pos]);
+
+        counts[id]++;
+        if (previous < slots && !(repeated && id == previous)) {
+            pairs.add(static_cast<uint64_t>(previous) << 32 | id, 1);
+            repeated = id == previous;
+        } else {
+            repeated = false;
+        }
+        previous = id;
+        pos += std::max<size_t>(length, 1);
+    }
+}
+
+/**
+ * @brief Learns symbols of several characters from a corpus.
+ *
+ * Pairs of adjacent tokens are merged into new symbols, most profitable
+ * first, in the manner of byte-pair encoding. Each round parses the corpus
+ * with the symbols known so far, in parallel over the files, each worker
+ * counting tokens into its own array and the pairs it sees into its own
+ * hash map, so memory grows with the pairs found rather than with the
+ * square of the symbols. A pair is scored by the bits its merge saves
+ * under an ideal code, c(ab) * (log2(n / c(a)) + log2(n / c(b)) -
+ * log2(n / c(ab))) for n tokens, and must save at least the bytes its
+ * line takes in the table. A round adds a fraction of the
+ * symbols asked for, so later rounds see the parse the earlier symbols
+ * produce, and can merge them into longer ones.
+ *
+ * Symbols never contain a line break, which the table cannot hold, and
+ * are at most MAX_TRAINED_LENGTH bytes long.
+ *
+ * @param input_list List of file paths.
+ * @param keywords_map Map of keywords; the symbols learned are added to it.
+ * @param chars_map Map of characters.
+ * @param count Number of symbols to learn, at most MAX_TRAINED_TOKENS.
+ * @param threads Number of worker threads; 0 uses one per hardware thread.
+ * @return Symbols learned, in the order they were found.
  */
-void count_frequencies_in_various_files(const std::vector<std::string> input_list, std::unordered_map<std::string, int>& keywords_map, std::unordered_map<std::string, int>& chars_map) {
-    for (auto file : input_list) {
-        count_frequencies_in_file(file, keywords_map, chars_map);
+std::vector<std::string> train_tokens(const std::vector<std::string> input_list, std::unordered_map<std::string, int>& keywords_map, const std::unordered_map<std::string, int>& chars_map, size_t count, unsigned threads) {
+    Stats::PhaseTimer timer(Stats::COUNT);
+    constexpr size_t rounds = 16;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(input_list.size(), 1)));
+    count = std::min(count, MAX_TRAINED_TOKENS);
+
+    std::vector<std::string> learned;
+    const size_t per_round = std::max<size_t>(1, (count + rounds - 1) / rounds);
+
+    while (learned.size() < count) {
+        const compiled_symbols compiled = compile_symbols(keywords_map, chars_map);
+        const size_t slots = compiled.symbols.size() + 256;
+
+        std::vector<std::vector<uint64_t>> local_counts(threads, std::vector<uint64_t>(slots, 0));
+        std::vector<pair_counts> local_pairs(threads);
+        std::vector<std::exception_ptr> errors(threads);
+        std::atomic<size_t> next{0};
+
+        auto worker = [&](unsigned t) {
+            try {
+                std::string buffer;
+                for (size_t i = next++; i < input_list.size(); i = next++) {
+                    MappedFile mapped(input_list[i]);
+                    if (mapped.isMapped()) {
+                        count_pairs_in_buffer(mapped.view().data(), mapped.view().size(), compiled, local_counts[t], local_pairs[t]);
+                    } else if (read_file(input_list[i], buffer)) {
+                        count_pairs_in_buffer(buffer.data(), buffer.size(), compiled, local_counts[t], local_pairs[t]);
+                    }
+                }
+            } catch (...) {
+                errors[t] = std::current_exception();
+            }
+        };
+
+        if (threads == 1) {
+            worker(0);
+        } else {
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; t++) workers.emplace_back(worker, t);
+            for (auto& w : workers) w.join();
+        }
+
+        for (unsigned t = 1; t < threads; t++) {
+            if (errors[t]) std::rethrow_exception(errors[t]);
+            for (size_t i = 0; i < slots; i++) local_counts[0][i] += local_counts[t][i];
+            for (const auto& [key, together] : local_pairs[t].entries) {
+                if (key != pair_counts::EMPTY) local_pairs[0].add(key, together);
+            }
+            local_pairs[t] = pair_counts();
+        }
+        if (errors[0]) std::rethrow_exception(errors[0]);
+        const std::vector<uint64_t>& counts = local_counts[0];
+        const pair_counts& pairs = local_pairs[0];
+
+        uint64_t tokens = 0;
+        for (uint64_t c : counts) tokens += c;
+        auto text = [&](size_t slot) {
+            return slot < compiled.symbols.size() ? compiled.symbols[slot] : std::string(1, static_cast<char>(slot - compiled.symbols.size()));
+        };
+        auto bits = [&](uint64_t c) { return std::log2(static_cast<double>(tokens) / static_cast<double>(c)); };
+
+        std::vector<std::pair<double, std::string>> candidates;
+        for (const auto& [key, together] : pairs.entries) {
+            if (key == pair_counts::EMPTY || together < 2) continue;
+            const size_t a = static_cast<size_t>(key >> 32), b = static_cast<size_t>(key & 0xFFFFFFFF);
+
+            std::string merged = text(a) + text(b);
+            if (merged.size() > MAX_TRAINED_LENGTH || merged.find_first_of("\r\n") != std::string::npos ||
+                keywords_map.count(merged) || chars_map.count(merged)) {
+                continue;
+            }
+
+            const double saved = static_cast<double>(together) * (bits(counts[a]) + bits(counts[b]) - bits(together));
+            // The symbol must pay for its line in the table, count included
+            const double table_bits = 8.0 * static_cast<double>(merged.size() + 12);
+            if (saved > table_bits) candidates.push_back({saved, std::move(merged)});
+        }
+        if (candidates.empty()) break;
+
+        // Different pairs can spell the same symbol ("ab" + "c" and "a" + "bc"); keep the best of each
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const auto& x, const auto& y) { return x.second < y.second || (x.second == y.second && x.first > y.first); });
+        candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                                     [](const auto& x, const auto& y) { return x.second == y.second; }),
+                         candidates.end());
+
+        const size_t take = std::min({per_round, count - learned.size(), candidates.size()});
+        std::partial_sort(candidates.begin(), candidates.begin() + take, candidates.end(),
+                          [](const auto& x, const auto& y) { return x.first > y.first || (x.first == y.first && x.second < y.second); });
+        for (size_t i = 0; i < take; i++) {
+            keywords_map.emplace(candidates[i].second, 0);
+            learned.push_back(std::move(candidates[i].second));
+        }
     }
+    return learned;
+}
+
+/**
+ * @brief Removes the learned symbols the corpus no longer uses.
+ *
+ * Later merges take over the text of earlier ones, so a symbol learned in
+ * an early round can end with no occurrence in the final parse. It would
+ * only take a line of the table and a code, so it is dropped from both
+ * the keywords map and the list of learned symbols.
+ *
+ * @param learned Symbols learned by train_tokens().
+ * @param keywords_map Map of keywords, counted with the learned symbols.
+ */
+void prune_trained_tokens(std::vector<std::string>& learned, std::unordered_map<std::string, int>& keywords_map) {
+    auto unused = [&](const std::string& symbol) {
+        auto it = keywords_map.find(symbol);
+        if (it == keywords_map.end() || it->second > 0) return false;
+        keywords_map.erase(it);
+        return true;
+    };
+    learned.erase(std::remove_if(learned.begin(), learned.end(), unused), learned.end());
 }
 
 /**
  * @brief Creates a frequency table and writes it to a file.
+ *
+ * Characters come first, then keywords, each sorted, so the same counts
+ * always produce the same file.
+ *
  * @param path Output file path.
  * @param keywords_map Map of keywords and their frequencies.
  * @param chars_map Map of characters and their frequencies.
@@ -185,11 +727,11 @@ void count_frequencies_in_various_files(const std::vector<std::string> input_lis
 void create_frequency_table(const std::string path, const std::unordered_map<std::string, int>& keywords_map, const std::unordered_map<std::string, int>& chars_map) {
     std::ofstream file(path);
 
-    for (const auto& [word, count] : chars_map) {
+    for (const auto& [word, count] : std::map<std::string, int>(chars_map.begin(), chars_map.end())) {
         file << word << ":" << count << '\n';
     }
 
-    for (const auto& [word, count] : keywords_map) {
+    for (const auto& [word, count] : std::map<std::string, int>(keywords_map.begin(), keywords_map.end())) {
         file << word << ":" << count << '\n';
     }
 
@@ -10,11 +10,22 @@
 #include <unordered_set>
 #include <fstream>
 #include <unordered_map>
+#include <cstddef>
 namespace fs = std::filesystem;
 
 #ifndef FREQUENCY_TABLE_HPP
 #define FREQUENCY_TABLE_HPP
 
+/**
+ * @brief Most symbols train_tokens() learns in one run.
+ */
+constexpr size_t MAX_TRAINED_TOKENS = 1024;
+
+/**
+ * @brief Longest symbol train_tokens() learns, in bytes.
+ */
+constexpr size_t MAX_TRAINED_LENGTH = 32;
+
 /**
  * @brief Verifies the input path and populates a list of .cpp files.
  * @param arg Path to file or directory.
@@ -29,15 +40,12 @@ void verifies_path(std::string arg, std::vector<std::string>& input_list);
  */
 std::unordered_map<std::string, int> create_unordered_map_from_file(std::string file_path);
 
-/**
- * @brief Parses a line into tokens, separating by spaces.
- * @param str Input string.
- * @return Vector of tokens.
- */
-std::vector<std::string> line_parser(const std::string str);
-
 /**
  * @brief Counts frequencies of keywords and characters in a file.
+ *
+ * The longest keyword or character is taken at each position, the same
+ * parse the compressor does. Characters not in the map are added to it.
+ *
  * @param path Path to the file.
  * @param keywords_map Map of keywords and their frequencies.
  * @param chars_map Map of characters and their frequencies.
@@ -46,11 +54,69 @@ void count_frequencies_in_file(const std::string path, std::unordered_map<std::s
 
 /**
  * @brief Counts frequencies in multiple files.
+ *
+ * Each file is scanned once through a trie compiled from the keys of the
+ * maps. Files are counted in parallel into per-thread arrays, added up at
+ * the end; the result is the same as a serial run.
+ *
+ * With a cache path, the counts of each file are cached there by path,
+ * size, modification time and content hash, and only the files that
+ * changed since the previous run are scanned.
+ *
  * @param input_list List of file paths.
  * @param keywords_map Map of keywords and their frequencies.
  * @param chars_map Map of characters and their frequencies.
+ * @param threads Number of worker threads; 0 uses one per hardware thread.
+ * @param cache_path Path to the count cache; empty to count every file.
+ * @return Number of files whose counts came from the cache.
+ * @throws std::runtime_error If the cache cannot be written.
+ */
+size_t count_frequencies_in_various_files(const std::vector<std::string> input_list, std::unordered_map<std::string, int>& keywords_map, std::unordered_map<std::string, int>& chars_map, unsigned threads = 1, const std::string& cache_path = "");
+
+/**
+ * @brief Counts frequencies of keywords and characters in an input to compress.
+ *
+ * Every byte is counted, carriage returns included, so the counts describe
+ * exactly the bytes the compressor will encode. Characters not in the map
+ * are added to it. Memory use does not depend on the file size.
+ *
+ * @param path Path to the file.
+ * @param keywords_map Map of keywords and their frequencies.
+ * @param chars_map Map of characters and their frequencies.
+ * @throws std::runtime_error If the file cannot be read.
+ */
+void count_frequencies_in_input(const std::string& path, std::unordered_map<std::string, int>& keywords_map, std::unordered_map<std::string, int>& chars_map);
+
+/**
+ * @brief Learns symbols of several characters from a corpus.
+ *
+ * Adjacent tokens of the greedy parse are merged into new symbols, the
+ * ones saving the most bits first, over several rounds of parallel
+ * counting. The symbols are added to the keywords map, so counting the
+ * corpus afterwards puts them in the table, and the compressor matches
+ * them like any keyword.
+ *
+ * @param input_list List of file paths.
+ * @param keywords_map Map of keywords; the symbols learned are added to it.
+ * @param chars_map Map of characters.
+ * @param count Number of symbols to learn, at most MAX_TRAINED_TOKENS.
+ * @param threads Number of worker threads; 0 uses one per hardware thread.
+ * @return Symbols learned, in the order they were found; fewer than count
+ *         if no other merge pays for itself.
+ */
+std::vector<std::string> train_tokens(const std::vector<std::string> input_list, std::unordered_map<std::string, int>& keywords_map, const std::unordered_map<std::string, int>& chars_map, size_t count, unsigned threads = 1);
+
+/**
+ * @brief Removes the learned symbols the corpus no longer uses.
+ *
+ * Call it after counting the corpus with the learned symbols: those with
+ * a count of zero, taken over by later merges, are removed from the
+ * keywords map and from the list.
+ *
+ * @param learned Symbols learned by train_tokens().
+ * @param keywords_map Map of keywords, counted with the learned symbols.
  */
-void count_frequencies_in_various_files(const std::vector<std::string> input_list, std::unordered_map<std::string, int>& keywords_map, std::unordered_map<std::string, int>& chars_map);
+void prune_trained_tokens(std::vector<std::string>& learned, std::unordered_map<std::string, int>& keywords_map);
 
 /**
  * @brief Creates a frequency table and writes it to a file.
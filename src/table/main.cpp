@@ -4,7 +4,9 @@
  */
 
 #include "frequency-table.hpp"
+#include "../sempress/stats.hpp"
 #include <iostream>
+#include <string>
 #include <vector>
 
 /**
@@ -14,31 +16,93 @@
  * @return Exit code.
  */
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <input_file_or_dir> [output_file]" << std::endl;
+    std::vector<std::string> paths;
+    unsigned threads = 0;
+    bool stats = false, stats_json = false;
+    std::string cache_path;
+    size_t train = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "-j" && i + 1 < argc) {
+            try {
+                threads = static_cast<unsigned>(std::stoul(argv[++i]));
+            } catch (const std::exception&) {
+                std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--train" && i + 1 < argc) {
+            try {
+                train = std::stoul(argv[++i]);
+            } catch (const std::exception&) {
+                std::cerr << "Invalid symbol count: " << argv[i] << std::endl;
+                return 1;
+            }
+            if (train > MAX_TRAINED_TOKENS) {
+                std::cerr << "At most " << MAX_TRAINED_TOKENS << " symbols can be learned" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cache_path = argv[++i];
+        } else if (arg == "--stats" || arg == "--stats=text" || arg == "--stats=json") {
+            stats = true;
+            stats_json = arg == "--stats=json";
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.empty() || paths.size() > 2) {
+        std::cerr << "Usage: " << argv[0] << " [-j N] [--train K] [--cache <file>] [--stats[=json]] <input_file_or_dir> [output_file]" << std::endl;
         std::cerr << "  <input_file_or_dir>: Path to a .cpp file or a directory to scan for .cpp files." << std::endl;
         std::cerr << "  [output_file]:       Optional. Path to save the frequency table. Defaults to ../../outputs/frequency-table.txt" << std::endl;
+        std::cerr << "  -j N:                Optional. Number of counting threads. Defaults to one per hardware thread." << std::endl;
+        std::cerr << "  --train K:           Optional. Learn up to K symbols of several characters from the input and add them to the table." << std::endl;
+        std::cerr << "  --cache <file>:      Optional. Keep the counts of each file there and only rescan the files that changed." << std::endl;
+        std::cerr << "  --stats[=json]:      Optional. Write bytes and tokens counted and the counting time to stderr." << std::endl;
         return 1;
     }
 
     std::vector<std::string> input_list;
     
-    std::string file_path(argv[1]);
+    std::string file_path(paths[0]);
 
     verifies_path(file_path, input_list);
 
     std::unordered_map<std::string, int> keywords_map = create_unordered_map_from_file("inputs/cpp-keywords.txt");
     std::unordered_map<std::string, int> chars_map = create_unordered_map_from_file("inputs/ascii_chars.txt");
 
-    count_frequencies_in_various_files(input_list, keywords_map, chars_map);
+    try {
+        std::vector<std::string> learned;
+        if (train > 0) learned = train_tokens(input_list, keywords_map, chars_map, train, threads);
+        size_t cached = count_frequencies_in_various_files(input_list, keywords_map, chars_map, threads, cache_path);
+        if (train > 0) {
+            prune_trained_tokens(learned, keywords_map);
+            std::cout << "Learned " << learned.size() << " symbols from " << input_list.size() << " files\n";
+        }
+        if (!cache_path.empty()) {
+            std::cout << "Counted " << input_list.size() - cached << " of " << input_list.size() << " files (" << cached << " unchanged, from the cache)\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
 
-    if(argc == 3) {
-        create_frequency_table(argv[2], keywords_map, chars_map);
-        std::cout << "Frequency table sucessfully created in file " << "\"" << argv[2] << "\"\n";
+    if(paths.size() == 2) {
+        create_frequency_table(paths[1], keywords_map, chars_map);
+        std::cout << "Frequency table sucessfully created in file " << "\"" << paths[1] << "\"\n";
     } else {
         create_frequency_table("outputs/frequency-table.txt", keywords_map, chars_map);
         std::cout << "Frequency table sucessfully created in file \"outputs/frequency-table.txt\"\n";
     }
 
+    if (stats) {
+        if (Stats::ENABLED) {
+            Stats::report(std::cerr, stats_json);
+        } else {
+            std::cerr << "Statistics were compiled out; build with STATS=1 to get them." << std::endl;
+        }
+    }
+
     return 0;
 }
\ No newline at end of file